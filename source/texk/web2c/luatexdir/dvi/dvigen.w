@@ -647,12 +647,17 @@ output an array of words with one system call.
 @^inner loop@>
 @^defecation@>
 
+Since the two halves of |dvi_buf| are contiguous in memory, we simply hand
+the whole range to |xfwrite| in one call instead of going through |fputc|
+for every byte; the stdio layer then passes blocks of |half_buf| bytes
+straight on to the file.
+
 @c
 static void write_dvi(dvi_index a, dvi_index b)
 {
-    dvi_index k;
-    for (k = a; k <= b; k++)
-        fputc(dvi_buf[k], static_pdf->file);
+    if (b >= a)
+        xfwrite(dvi_buf + a, sizeof(eight_bits), (size_t) (b - a + 1),
+                static_pdf->file);
 }
 
 /* outputs half of the buffer */
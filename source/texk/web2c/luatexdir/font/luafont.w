@@ -152,7 +152,8 @@ static void dump_math_kerns(lua_State * L, charinfo * co, int l, int id)
 }
 
 
-static void font_char_to_lua(lua_State * L, internal_font_number f, charinfo * co)
+static void font_char_to_lua(lua_State * L, internal_font_number f, int c,
+                             charinfo * co)
 {
     liginfo *l;
     kerninfo *ki;
@@ -160,33 +161,33 @@ static void font_char_to_lua(lua_State * L, internal_font_number f, charinfo * c
     lua_createtable(L, 0, 10);
 
     lua_pushstring(L, "width");
-    lua_pushnumber(L, get_charinfo_width(co));
+    lua_pushnumber(L, char_scaled(f, get_charinfo_width(co)));
     lua_rawset(L, -3);
 
     lua_pushstring(L, "height");
-    lua_pushnumber(L, get_charinfo_height(co));
+    lua_pushnumber(L, char_scaled(f, get_charinfo_height(co)));
     lua_rawset(L, -3);
 
     lua_pushstring(L, "depth");
-    lua_pushnumber(L, get_charinfo_depth(co));
+    lua_pushnumber(L, char_scaled(f, get_charinfo_depth(co)));
     lua_rawset(L, -3);
 
 
     if (get_charinfo_italic(co) != 0) {
        lua_pushstring(L, "italic");
-       lua_pushnumber(L, get_charinfo_italic(co));
+       lua_pushnumber(L, char_scaled(f, get_charinfo_italic(co)));
        lua_rawset(L, -3);
     }
 
     if (get_charinfo_top_accent(co) !=0) {
        lua_pushstring(L, "top_accent");
-       lua_pushnumber(L, get_charinfo_top_accent(co));
+       lua_pushnumber(L, char_scaled(f, get_charinfo_top_accent(co)));
        lua_rawset(L, -3);
     }
 
     if (get_charinfo_bot_accent(co) != 0) {
        lua_pushstring(L, "bot_accent")	;
-       lua_pushnumber(L, get_charinfo_bot_accent(co));
+       lua_pushnumber(L, char_scaled(f, get_charinfo_bot_accent(co)));
        lua_rawset(L, -3);
     }      
 
@@ -233,7 +234,10 @@ static void font_char_to_lua(lua_State * L, internal_font_number f, charinfo * c
     }
 
     lua_pushstring(L, "used");
-    lua_pushboolean(L, (get_charinfo_used(co) ? true : false));
+    if (font_shared(f))         /* an instance keeps its own used characters */
+        lua_pushboolean(L, (char_used(f, c) ? true : false));
+    else
+        lua_pushboolean(L, (get_charinfo_used(co) ? true : false));
     lua_rawset(L, -3);
 
     if (get_charinfo_tag(co) == ext_tag) {
@@ -284,7 +288,7 @@ static void font_char_to_lua(lua_State * L, internal_font_number f, charinfo * c
             } else {
                 lua_pushnumber(L, kern_char(ki[i]));
             }
-            lua_pushnumber(L, kern_kern(ki[i]));
+            lua_pushnumber(L, char_scaled(f, kern_kern(ki[i])));
             lua_rawset(L, -3);
         }
         lua_rawset(L, -3);
@@ -512,12 +516,12 @@ int font_to_lua(lua_State * L, int f)
 
     if (has_left_boundary(f)) {
         co = get_charinfo(f, left_boundarychar);
-        font_char_to_lua(L, f, co);
+        font_char_to_lua(L, f, left_boundarychar, co);
         lua_setfield(L, -2, "left_boundary");
     }
     if (has_right_boundary(f)) {
         co = get_charinfo(f, right_boundarychar);
-        font_char_to_lua(L, f, co);
+        font_char_to_lua(L, f, right_boundarychar, co);
         lua_setfield(L, -2, "right_boundary");
     }
 
@@ -525,7 +529,7 @@ int font_to_lua(lua_State * L, int f)
         if (quick_char_exists(f, k)) {
             lua_pushnumber(L, k);
             co = get_charinfo(f, k);
-            font_char_to_lua(L, f, co);
+            font_char_to_lua(L, f, k, co);
             lua_rawset(L, -3);
         }
     }
@@ -1115,6 +1119,7 @@ font_char_from_lua(lua_State * L, internal_font_number f, int i,
         set_charinfo_rp(co, j);
         k = n_boolean_field(L, lua_key_index(used), 0);
         set_charinfo_used(co, k);
+        set_font_used_char(f, i, k);
         s = n_string_field(L, lua_key_index(name));
         if (s != NULL)
             set_charinfo_name(co, xstrdup(s));
@@ -2246,6 +2251,1217 @@ halfword handle_kerning(halfword head, halfword tail)
     return tail;
 }
 
+@* OpenType shaping.
+
+A font can carry the \.{GSUB}, \.{GPOS} and \.{GDEF} tables of its
+OpenType file, together with the lookups that a selection of features
+asks for (see \.{font.setshaping}). Runs of character nodes in such a
+font are then shaped by |handle_shaping| before the ligaturing and
+kerning passes, without a round trip through Lua.
+
+The tables are kept in their binary form, because that form is already
+a compact and well indexed one. `Compiling' the lookups means resolving
+the script, language and features into an ordered list of lookups, and
+recording for each of them the set of glyphs it can start at, so that
+most glyphs are dismissed with a single bit test. All reads are checked
+against the table lengths; a damaged table reads as zeros, which
+matches nothing.
+
+Glyph nodes carry characters, while lookups work on glyph ids, so the
+|index| of the font's characters maps one to the other. A substitution
+into a glyph that has no character in the font is not done.
+
+@c
+typedef struct {
+    unsigned offset;            /* of the lookup, in its table */
+    unsigned char *coverage;    /* bitset of the glyphs it may apply to */
+    int gpos;                   /* a \.{GPOS} lookup? */
+} ot_lookup;
+
+struct ot_shaper {
+    ot_table gsub, gpos, gdef;
+    int num_glyphs;
+    int units_per_em;
+    int *glyph_chars;           /* glyph id to character, or $-1$ */
+    int alternate;              /* the one to pick from alternate sets */
+    unsigned glyph_classes;     /* \.{GDEF} class definitions, or zero */
+    unsigned mark_classes;
+    unsigned mark_sets;
+    int num_lookups;
+    ot_lookup *lookups;         /* \.{GSUB} ones first */
+    int ref_count;
+};
+
+static int ot_shaper_count = 0;       /* fonts with shaping data */
+
+#define ot_u16(t,p) ((p) < (t)->len && (t)->len - (p) >= 2 ? \
+    (unsigned) (((t)->data[(p)] << 8) | (t)->data[(p) + 1]) : 0U)
+#define ot_s16(t,p) ((int) (short) ot_u16(t,p))
+
+static unsigned ot_u32(const ot_table * t, unsigned p)
+{
+    return (ot_u16(t, p) << 16) | ot_u16(t, p + 2);
+}
+
+@ Counts are trusted only as far as the table can hold the |size|-byte
+items that follow them. This keeps damaged tables from making the loops
+below run long.
+
+@c
+static unsigned ot_count(const ot_table * t, unsigned p, unsigned size)
+{
+    unsigned n = ot_u16(t, p);
+    unsigned room = (p < t->len && t->len - p >= 2 ? (t->len - p - 2) / size : 0);
+    return (n < room ? n : room);
+}
+
+@ Coverage tables give the index of a glyph in a subtable's arrays,
+class definitions the class of a glyph. Both are sorted, so a binary
+search does.
+
+@c
+static int ot_coverage(const ot_table * t, unsigned p, int g)
+{
+    unsigned lo = 0, hi = ot_u16(t, p + 2);
+    switch (ot_u16(t, p)) {
+    case 1:
+        while (lo < hi) {
+            unsigned m = (lo + hi) / 2;
+            int v = (int) ot_u16(t, p + 4 + 2 * m);
+            if (v == g)
+                return (int) m;
+            if (v < g)
+                lo = m + 1;
+            else
+                hi = m;
+        }
+        break;
+    case 2:
+        while (lo < hi) {
+            unsigned m = (lo + hi) / 2;
+            unsigned r = p + 4 + 6 * m;
+            if (g < (int) ot_u16(t, r))
+                hi = m;
+            else if (g > (int) ot_u16(t, r + 2))
+                lo = m + 1;
+            else
+                return (int) (ot_u16(t, r + 4) + (unsigned) g - ot_u16(t, r));
+        }
+        break;
+    }
+    return -1;
+}
+
+static int ot_class(const ot_table * t, unsigned p, int g)
+{
+    unsigned lo = 0, hi;
+    if (p == 0)
+        return 0;
+    switch (ot_u16(t, p)) {
+    case 1:
+        lo = ot_u16(t, p + 2);
+        if (g >= (int) lo && g < (int) (lo + ot_u16(t, p + 4)))
+            return (int) ot_u16(t, p + 6 + 2 * ((unsigned) g - lo));
+        break;
+    case 2:
+        hi = ot_u16(t, p + 2);
+        while (lo < hi) {
+            unsigned m = (lo + hi) / 2;
+            unsigned r = p + 4 + 6 * m;
+            if (g < (int) ot_u16(t, r))
+                hi = m;
+            else if (g > (int) ot_u16(t, r + 2))
+                lo = m + 1;
+            else
+                return (int) ot_u16(t, r + 4);
+        }
+        break;
+    }
+    return 0;
+}
+
+static void ot_coverage_bits(const ot_table * t, unsigned p, unsigned char *set,
+                             int num_glyphs)
+{
+    unsigned k, n = ot_count(t, p + 2, (ot_u16(t, p) == 1 ? 2 : 6));
+    int g, last;
+    for (k = 0; k < n; k++) {
+        switch (ot_u16(t, p)) {
+        case 1:
+            g = (int) ot_u16(t, p + 4 + 2 * k);
+            if (g < num_glyphs)
+                set[g >> 3] |= (unsigned char) (1 << (g & 7));
+            break;
+        case 2:
+            last = (int) ot_u16(t, p + 4 + 6 * k + 2);
+            for (g = (int) ot_u16(t, p + 4 + 6 * k); g <= last && g < num_glyphs; g++)
+                set[g >> 3] |= (unsigned char) (1 << (g & 7));
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+@ Lookups are a list of subtables of one type. Extension subtables (type
+7 in \.{GSUB}, 9 in \.{GPOS}) only point to a subtable elsewhere, with
+a 32-bit offset; |ot_subtable| looks through them.
+
+@c
+#define ot_lookup_flag(t,l)   ot_u16(t, (l) + 2)
+#define ot_subtable_count(t,l) ot_count(t, (l) + 4, 2)
+
+#define ignore_base_glyphs 0x0002
+#define ignore_ligatures   0x0004
+#define ignore_marks       0x0008
+#define use_mark_filtering 0x0010
+
+#define base_glyph_class 1
+#define ligature_glyph_class 2
+#define mark_glyph_class 3
+
+static unsigned ot_subtable(const ot_table * t, int gpos, unsigned l, unsigned k,
+                            unsigned *type)
+{
+    unsigned s = l + ot_u16(t, l + 6 + 2 * k);
+    *type = ot_u16(t, l);
+    if (*type == (gpos ? 9U : 7U) && ot_u16(t, s) == 1) {
+        *type = ot_u16(t, s + 2);
+        s += ot_u32(t, s + 4);
+    }
+    return s;
+}
+
+static unsigned ot_lookup_offset(const ot_table * t, unsigned index)
+{
+    unsigned list = ot_u16(t, 8);
+    if (list == 0 || index >= ot_u16(t, list))
+        return 0;
+    return list + ot_u16(t, list + 2 + 2 * index);
+}
+
+@ The glyphs a lookup may start at are those of the first coverage table
+of each of its subtables. Reverse chaining substitutions and cursive
+attachments are not supported and get an empty set.
+
+@c
+static void ot_lookup_bits(ot_shaper * sh, ot_lookup * l)
+{
+    const ot_table *t = (l->gpos ? &sh->gpos : &sh->gsub);
+    unsigned k, n = ot_subtable_count(t, l->offset);
+    for (k = 0; k < n; k++) {
+        unsigned type;
+        unsigned s = ot_subtable(t, l->gpos, l->offset, k, &type);
+        unsigned c = s + ot_u16(t, s + 2);
+        if (type == 0 || (l->gpos ? (type == 3 || type > 8) : type > 6))
+            continue;
+        if ((l->gpos ? (type == 7 || type == 8) : (type == 5 || type == 6))
+            && ot_u16(t, s) == 3) {
+            if (type == (l->gpos ? 8U : 6U))
+                c = s + ot_u16(t, s + 6 + 2 * ot_u16(t, s + 2));
+            else
+                c = s + ot_u16(t, s + 6);
+        }
+        ot_coverage_bits(t, c, l->coverage, sh->num_glyphs);
+    }
+}
+
+@ Feature selection follows the script list down to a language system,
+falling back to the default language system of a script and to the
+\.{DFLT}, \.{dflt} and \.{latn} scripts, as other shapers do. The lookups
+of all selected features are applied in the order of the lookup list.
+
+@c
+static int ot_tag_is(const ot_table * t, unsigned p, const char *tag)
+{
+    char s[4] = { ' ', ' ', ' ', ' ' };
+    unsigned k;
+    if (p >= t->len || t->len - p < 4)
+        return 0;
+    for (k = 0; k < 4 && tag[k] != '\0'; k++)
+        s[k] = tag[k];
+    return memcmp(t->data + p, s, 4) == 0;
+}
+
+static unsigned ot_find_record(const ot_table * t, unsigned p, unsigned base,
+                               const char *tag)
+{
+    unsigned k, n = ot_count(t, p, 6);
+    for (k = 0; k < n; k++) {
+        if (ot_tag_is(t, p + 2 + 6 * k, tag))
+            return base + ot_u16(t, p + 2 + 6 * k + 4);
+    }
+    return 0;
+}
+
+static unsigned ot_langsys(const ot_table * t, const char *script,
+                           const char *language)
+{
+    const char *scripts[] = { "DFLT", "DFLT", "dflt", "latn" };
+    unsigned list = ot_u16(t, 4), s = 0, l = 0;
+    int k;
+    if (list == 0)
+        return 0;
+    if (script != NULL)
+        scripts[0] = script;
+    for (k = 0; k < 4 && s == 0; k++)
+        s = ot_find_record(t, list, list, scripts[k]);
+    if (s == 0)
+        return 0;
+    if (language != NULL)
+        l = ot_find_record(t, s + 2, s, language);
+    if (l == 0 && ot_u16(t, s) != 0)
+        l = s + ot_u16(t, s);
+    return l;
+}
+
+static void ot_select_lookups(ot_shaper * sh, int gpos, const char *script,
+                              const char *language, const char **features,
+                              int num_features)
+{
+    const ot_table *t = (gpos ? &sh->gpos : &sh->gsub);
+    unsigned l = ot_langsys(t, script, language);
+    unsigned fl = ot_u16(t, 6);
+    unsigned ll = ot_u16(t, 8);
+    unsigned k, n, m, count, index;
+    char *wanted;
+    int i;
+    if (l == 0 || fl == 0 || ll == 0)
+        return;
+    count = ot_count(t, ll, 2);
+    if (count == 0)
+        return;
+    wanted = xcalloc(count, 1);
+    n = ot_count(t, l + 4, 2);
+    for (k = 0; k <= n; k++) {
+        unsigned rec, ft;
+        index = (k == n ? ot_u16(t, l + 2) : ot_u16(t, l + 6 + 2 * k));
+        if (index >= ot_count(t, fl, 6))
+            continue;           /* also for a missing required feature */
+        rec = fl + 2 + 6 * index;
+        if (k < n) {
+            for (i = 0; i < num_features; i++)
+                if (ot_tag_is(t, rec, features[i]))
+                    break;
+            if (i == num_features)
+                continue;
+        }
+        ft = fl + ot_u16(t, rec + 4);
+        for (m = 0; m < ot_count(t, ft + 2, 2); m++) {
+            index = ot_u16(t, ft + 4 + 2 * m);
+            if (index < count)
+                wanted[index] = 1;
+        }
+    }
+    for (index = 0; index < count; index++) {
+        ot_lookup *lk;
+        if (!wanted[index] || ot_lookup_offset(t, index) == 0)
+            continue;
+        sh->lookups = xreallocarray(sh->lookups, ot_lookup,
+                                    (unsigned) (sh->num_lookups + 1));
+        lk = sh->lookups + sh->num_lookups;
+        lk->offset = ot_lookup_offset(t, index);
+        lk->gpos = gpos;
+        lk->coverage = xcalloc((size_t) (sh->num_glyphs + 7) / 8, 1);
+        ot_lookup_bits(sh, lk);
+        sh->num_lookups++;
+    }
+    xfree(wanted);
+}
+
+@ The shaper keeps its own copy of the tables.
+
+@c
+static void ot_copy_table(ot_table * to, ot_table * from)
+{
+    unsigned char *d = NULL;
+    to->len = 0;
+    if (from != NULL && from->data != NULL && from->len > 0) {
+        d = xmalloc(from->len);
+        memcpy(d, from->data, from->len);
+        to->len = from->len;
+    }
+    to->data = d;
+}
+
+ot_shaper *new_ot_shaper(internal_font_number f, ot_table * gsub,
+                         ot_table * gpos, ot_table * gdef, int num_glyphs,
+                         int units_per_em, const char *script,
+                         const char *language, const char **features,
+                         int num_features, int alternate)
+{
+    int c, g;
+    ot_shaper *sh = xcalloc(1, sizeof(ot_shaper));
+    ot_copy_table(&sh->gsub, gsub);
+    ot_copy_table(&sh->gpos, gpos);
+    ot_copy_table(&sh->gdef, gdef);
+    sh->num_glyphs = num_glyphs;
+    sh->units_per_em = (units_per_em > 0 ? units_per_em : 1000);
+    sh->alternate = (alternate > 0 ? alternate - 1 : 0);
+    sh->ref_count = 1;
+    if (ot_u16(&sh->gdef, 4) != 0)
+        sh->glyph_classes = ot_u16(&sh->gdef, 4);
+    if (ot_u16(&sh->gdef, 10) != 0)
+        sh->mark_classes = ot_u16(&sh->gdef, 10);
+    if (ot_u32(&sh->gdef, 0) >= 0x00010002 && ot_u16(&sh->gdef, 12) != 0)
+        sh->mark_sets = ot_u16(&sh->gdef, 12);
+    sh->glyph_chars = xmalloc((unsigned) num_glyphs * sizeof(int));
+    for (g = 0; g < num_glyphs; g++)
+        sh->glyph_chars[g] = -1;
+    for (c = font_bc(f); c <= font_ec(f); c++) {
+        if (quick_char_exists(f, c)) {
+            g = char_index(f, c);
+            if (g > 0 && g < num_glyphs && sh->glyph_chars[g] < 0)
+                sh->glyph_chars[g] = c;
+        }
+    }
+    ot_select_lookups(sh, 0, script, language, features, num_features);
+    ot_select_lookups(sh, 1, script, language, features, num_features);
+    ot_shaper_count++;
+    return sh;
+}
+
+int ot_shaper_lookups(ot_shaper * sh)
+{
+    return sh->num_lookups;
+}
+
+ot_shaper *share_ot_shaper(ot_shaper * sh)
+{
+    if (sh != NULL)
+        sh->ref_count++;
+    return sh;
+}
+
+void release_ot_shaper(ot_shaper * sh)
+{
+    int i;
+    if (sh == NULL || --sh->ref_count > 0)
+        return;
+    for (i = 0; i < sh->num_lookups; i++)
+        xfree(sh->lookups[i].coverage);
+    xfree(sh->lookups);
+    xfree(sh->glyph_chars);
+    xfree(sh->gsub.data);
+    xfree(sh->gpos.data);
+    xfree(sh->gdef.data);
+    xfree(sh);
+    ot_shaper_count--;
+}
+
+void set_font_shaper(internal_font_number f, ot_shaper * sh)
+{
+    release_ot_shaper(font_shaper(f));
+    font_shaper(f) = sh;
+}
+
+@ The same readers give |font.read_sfnt| its view of the layout tables:
+|ot_feature_list| collects the script, language and feature tags of a
+\.{GSUB} or \.{GPOS} table, in table order, and |ot_gdef_glyph_class|
+looks up the class of a glyph in a \.{GDEF} table. The default language
+system of a script is reported as language \.{dflt}.
+
+@c
+static void ot_tag_copy(const ot_table * t, unsigned p, char *tag)
+{
+    if (p < t->len && t->len - p >= 4)
+        memcpy(tag, t->data + p, 4);
+    else
+        memcpy(tag, "    ", 4);
+}
+
+static int ot_add_features(const ot_table * t, unsigned l, const char *script,
+                           const char *language, ot_feature_tag ** list, int n)
+{
+    unsigned fl = ot_u16(t, 6);
+    unsigned k, count = ot_count(t, l + 4, 2), index;
+    for (k = 0; k <= count; k++) {
+        ot_feature_tag *e;
+        index = (k == count ? ot_u16(t, l + 2) : ot_u16(t, l + 6 + 2 * k));
+        if (index >= ot_count(t, fl, 6))
+            continue;           /* also for a missing required feature */
+        *list = xreallocarray(*list, ot_feature_tag, (unsigned) (n + 1));
+        e = *list + n;
+        memcpy(e->script, script, 4);
+        memcpy(e->language, language, 4);
+        ot_tag_copy(t, fl + 2 + 6 * index, e->feature);
+        n++;
+    }
+    return n;
+}
+
+int ot_feature_list(const ot_table * t, ot_feature_tag ** list)
+{
+    unsigned sl = ot_u16(t, 4);
+    unsigned k, m, ns, nl;
+    int n = 0;
+    *list = NULL;
+    if (sl == 0 || ot_u16(t, 6) == 0)
+        return 0;
+    ns = ot_count(t, sl, 6);
+    for (k = 0; k < ns; k++) {
+        char script[4], language[4];
+        unsigned sp = sl + ot_u16(t, sl + 2 + 6 * k + 4);
+        ot_tag_copy(t, sl + 2 + 6 * k, script);
+        if (ot_u16(t, sp) != 0)
+            n = ot_add_features(t, sp + ot_u16(t, sp), script, "dflt", list, n);
+        nl = ot_count(t, sp + 2, 6);
+        for (m = 0; m < nl; m++) {
+            ot_tag_copy(t, sp + 4 + 6 * m, language);
+            n = ot_add_features(t, sp + ot_u16(t, sp + 4 + 6 * m + 4), script,
+                                language, list, n);
+        }
+    }
+    return n;
+}
+
+int ot_gdef_glyph_class(const ot_table * gdef, int g)
+{
+    return ot_class(gdef, ot_u16(gdef, 4), g);
+}
+
+@ A run of glyphs is shaped in a buffer. Positioning is collected in the
+buffer as well, in scaled points: offsets end up in the |x_displace| and
+|y_displace| fields, advance changes as font kerns after the glyph.
+
+@c
+typedef struct {
+    halfword node;
+    int glyph;
+    int glyph_class;
+    scaled x_offset;
+    scaled y_offset;
+    scaled x_advance;
+} ot_glyph;
+
+typedef struct {
+    ot_shaper *sh;
+    internal_font_number f;
+    ot_glyph *g;
+    int n;
+    int size;
+    int depth;                  /* nesting of contextual lookups */
+} ot_buffer;
+
+static ot_buffer ot_buf = { NULL, 0, NULL, 0, 0, 0 };
+
+#define ot_max_depth 8
+
+static void ot_buffer_room(ot_buffer * b, int extra)
+{
+    if (b->n + extra > b->size) {
+        b->size = b->n + extra + 64;
+        b->g = xreallocarray(b->g, ot_glyph, (unsigned) b->size);
+    }
+}
+
+static int ot_glyph_class(ot_shaper * sh, int g)
+{
+    return ot_class(&sh->gdef, sh->glyph_classes, g);
+}
+
+static scaled ot_scale(ot_buffer * b, int v)
+{
+    double d = (double) v * (double) font_size(b->f) / b->sh->units_per_em;
+    return (scaled) (d < 0 ? d - 0.5 : d + 0.5);
+}
+
+static int ot_has_char(ot_buffer * b, int g)
+{
+    return (g >= 0 && g < b->sh->num_glyphs && b->sh->glyph_chars[g] >= 0);
+}
+
+static void ot_set_glyph(ot_buffer * b, int i, int g)
+{
+    b->g[i].glyph = g;
+    b->g[i].glyph_class = ot_glyph_class(b->sh, g);
+    character(b->g[i].node) = b->sh->glyph_chars[g];
+}
+
+@ New glyph nodes, for ligatures and for the extra glyphs of multiple
+substitutions, take their font, language data and attributes from an
+existing one, like the ligatures made by |try_ligature|.
+
+@c
+static halfword ot_new_glyph(halfword model)
+{
+    halfword p = raw_glyph_node();
+    subtype(p) = (quarterword) (subtype(model) & ~GLYPH_LIGATURE);
+    font(p) = font(model);
+    character(p) = character(model);
+    lang_data(p) = lang_data(model);
+    add_node_attr_ref(node_attr(model));
+    node_attr(p) = node_attr(model);
+    return p;
+}
+
+@ Lookup flags can make a lookup look through certain glyphs: base
+glyphs, ligatures, all marks or the marks outside a class or set.
+
+@c
+static int ot_skip(ot_buffer * b, int i, unsigned flag, unsigned set)
+{
+    ot_shaper *sh = b->sh;
+    switch (b->g[i].glyph_class) {
+    case base_glyph_class:
+        return (flag & ignore_base_glyphs) != 0;
+    case ligature_glyph_class:
+        return (flag & ignore_ligatures) != 0;
+    case mark_glyph_class:
+        if (flag & ignore_marks)
+            return 1;
+        if (flag & use_mark_filtering) {
+            unsigned p = sh->mark_sets;
+            if (p == 0 || set >= ot_u16(&sh->gdef, p + 2))
+                return 1;
+            p += ot_u32(&sh->gdef, p + 4 + 4 * set);
+            return ot_coverage(&sh->gdef, p, b->g[i].glyph) < 0;
+        }
+        if ((flag & 0xFF00) != 0)
+            return ot_class(&sh->gdef, sh->mark_classes, b->g[i].glyph) !=
+                (int) (flag >> 8);
+        return 0;
+    }
+    return 0;
+}
+
+static int ot_next(ot_buffer * b, int i, unsigned flag, unsigned set)
+{
+    for (i++; i < b->n; i++)
+        if (!ot_skip(b, i, flag, set))
+            return i;
+    return -1;
+}
+
+static int ot_prev(ot_buffer * b, int i, unsigned flag, unsigned set)
+{
+    for (i--; i >= 0; i--)
+        if (!ot_skip(b, i, flag, set))
+            return i;
+    return -1;
+}
+
+@ Substitutions. Each applier returns whether it did something, and
+sets |*next| to where the enclosing loop continues.
+
+@c
+static int ot_apply(ot_buffer * b, const ot_table * t, int gpos, unsigned l,
+                    int i, int *next);
+
+static int ot_single(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                     int i, int *next)
+{
+    int g;
+    if (ot_u16(t, s) == 1)
+        g = (b->g[i].glyph + ot_s16(t, s + 4)) & 0xFFFF;
+    else if (k < (int) ot_u16(t, s + 4))
+        g = (int) ot_u16(t, s + 6 + 2 * (unsigned) k);
+    else
+        return 0;
+    if (!ot_has_char(b, g))
+        return 0;
+    ot_set_glyph(b, i, g);
+    *next = i + 1;
+    return 1;
+}
+
+static int ot_multiple(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                       int i, int *next)
+{
+    unsigned q, m, n;
+    halfword model = b->g[i].node;
+    if (k >= (int) ot_u16(t, s + 4))
+        return 0;
+    q = s + ot_u16(t, s + 6 + 2 * (unsigned) k);
+    if (q >= t->len)
+        return 0;
+    n = ot_count(t, q, 2);
+    for (m = 0; m < n; m++)
+        if (!ot_has_char(b, (int) ot_u16(t, q + 2 + 2 * m)))
+            return 0;
+    if (n == 0) {
+        flush_node(model);
+        memmove(b->g + i, b->g + i + 1, (size_t) (b->n - i - 1) * sizeof(ot_glyph));
+        b->n--;
+        *next = i;
+        return 1;
+    }
+    ot_buffer_room(b, (int) n - 1);
+    memmove(b->g + i + n, b->g + i + 1, (size_t) (b->n - i - 1) * sizeof(ot_glyph));
+    b->n += (int) n - 1;
+    for (m = 0; m < n; m++) {
+        b->g[i + (int) m] = b->g[i];
+        if (m > 0)
+            b->g[i + (int) m].node = ot_new_glyph(model);
+        ot_set_glyph(b, i + (int) m, (int) ot_u16(t, q + 2 + 2 * m));
+    }
+    *next = i + (int) n;
+    return 1;
+}
+
+static int ot_alternate(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                        int i, int *next)
+{
+    unsigned q;
+    int g;
+    if (k >= (int) ot_u16(t, s + 4))
+        return 0;
+    q = s + ot_u16(t, s + 6 + 2 * (unsigned) k);
+    if (b->sh->alternate >= (int) ot_u16(t, q))
+        return 0;
+    g = (int) ot_u16(t, q + 2 + 2 * (unsigned) b->sh->alternate);
+    if (!ot_has_char(b, g))
+        return 0;
+    ot_set_glyph(b, i, g);
+    *next = i + 1;
+    return 1;
+}
+
+@ A ligature replaces its first component; the other components leave
+the buffer, and marks that were skipped between them end up after it.
+The components are kept in |lig_ptr|, as for \TeX's own ligatures.
+
+@c
+#define ot_max_components 32
+
+static int ot_ligature(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                       int i, unsigned flag, unsigned set, int *next)
+{
+    int pos[ot_max_components];
+    unsigned q, r, m, c, n;
+    if (k >= (int) ot_u16(t, s + 4))
+        return 0;
+    q = s + ot_u16(t, s + 6 + 2 * (unsigned) k);
+    n = ot_count(t, q, 2);
+    for (m = 0; m < n; m++) {
+        unsigned count;
+        int g;
+        r = q + ot_u16(t, q + 2 + 2 * m);
+        g = (int) ot_u16(t, r);
+        count = ot_u16(t, r + 2);
+        if (count == 0 || count > ot_max_components || !ot_has_char(b, g))
+            continue;
+        pos[0] = i;
+        for (c = 1; c < count; c++) {
+            pos[c] = ot_next(b, pos[c - 1], flag, set);
+            if (pos[c] < 0 || b->g[pos[c]].glyph != (int) ot_u16(t, r + 4 + 2 * (c - 1)))
+                break;
+        }
+        if (c == count) {
+            halfword lig = ot_new_glyph(b->g[i].node);
+            halfword comp = null;
+            set_is_ligature(lig);
+            for (c = 0; c < count; c++) {
+                halfword p = b->g[pos[c]].node;
+                vlink(p) = null;
+                if (comp == null) {
+                    alink(p) = null;
+                    lig_ptr(lig) = p;
+                } else {
+                    couple_nodes(comp, p);
+                }
+                comp = p;
+            }
+            b->g[i].node = lig;
+            ot_set_glyph(b, i, g);
+            for (c = count - 1; c > 0; c--) {
+                memmove(b->g + pos[c], b->g + pos[c] + 1,
+                        (size_t) (b->n - pos[c] - 1) * sizeof(ot_glyph));
+                b->n--;
+            }
+            *next = i + 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+@ Contextual lookups, plain and chained, share one applier. The three
+formats describe the sequences to match as glyph ids, as classes or as
+coverage tables; |ot_sequence| hides that difference.
+
+@c
+typedef struct {
+    int format;
+    unsigned base;              /* of the subtable, for coverage offsets */
+    unsigned classes;           /* class definition, format 2 */
+} ot_sequence;
+
+static int ot_matches(ot_buffer * b, const ot_table * t, ot_sequence * q,
+                      unsigned p, int i)
+{
+    int v = (int) ot_u16(t, p), g = b->g[i].glyph;
+    switch (q->format) {
+    case 1:
+        return v == g;
+    case 2:
+        return v == ot_class(t, q->classes, g);
+    default:
+        return ot_coverage(t, q->base + (unsigned) v, g) >= 0;
+    }
+}
+
+#define ot_max_context 64
+
+static int ot_context(ot_buffer * b, const ot_table * t, int gpos, unsigned s,
+                      int chained, unsigned flag, unsigned set, int i, int *next)
+{
+    int pos[ot_max_context];
+    ot_sequence back, input, ahead;
+    unsigned format = ot_u16(t, s), rule, rules, count, r, m, n;
+    int j, k;
+    back.format = input.format = ahead.format = (int) format;
+    back.base = input.base = ahead.base = s;
+    back.classes = input.classes = ahead.classes = 0;
+    if (format == 3) {
+        rules = 1;
+        rule = s + 2;
+        if (!chained && ot_coverage(t, s + ot_u16(t, s + 6), b->g[i].glyph) < 0)
+            return 0;
+    } else {
+        k = ot_coverage(t, s + ot_u16(t, s + 2), b->g[i].glyph);
+        if (k < 0)
+            return 0;
+        if (format == 2) {
+            unsigned sets = (chained ? 10 : 6);      /* number of class sets */
+            if (chained) {
+                back.classes = s + ot_u16(t, s + 4);
+                ahead.classes = s + ot_u16(t, s + 8);
+            }
+            input.classes = s + ot_u16(t, s + (chained ? 6 : 4));
+            k = ot_class(t, input.classes, b->g[i].glyph);
+            if (k >= (int) ot_u16(t, s + sets))
+                return 0;
+            rule = s + ot_u16(t, s + sets + 2 + 2 * (unsigned) k);
+        } else if (format == 1) {
+            if (k >= (int) ot_u16(t, s + 4))
+                return 0;
+            rule = s + ot_u16(t, s + 6 + 2 * (unsigned) k);
+        } else {
+            return 0;
+        }
+        if (rule == s)
+            return 0;
+        rules = ot_count(t, rule, 2);
+    }
+    for (r = 0; r < rules; r++) {
+        unsigned p = (format == 3 ? rule : rule + ot_u16(t, rule + 2 + 2 * r));
+        unsigned first = (format == 3 ? 0 : 1);        /* first input glyph listed? */
+        if (chained) {
+            n = ot_u16(t, p);
+            for (m = 0, j = i; m < n; m++) {
+                j = ot_prev(b, j, flag, set);
+                if (j < 0 || !ot_matches(b, t, &back, p + 2 + 2 * m, j))
+                    break;
+            }
+            if (m < n)
+                continue;
+            p += 2 + 2 * n;
+        }
+        count = ot_u16(t, p);
+        if (count == 0 || count > ot_max_context)
+            continue;
+        p += (chained ? 2 : 4);
+        pos[0] = i;
+        for (m = 1; m < count; m++) {
+            pos[m] = ot_next(b, pos[m - 1], flag, set);
+            if (pos[m] < 0 || !ot_matches(b, t, &input, p + 2 * (m - first), pos[m]))
+                break;
+        }
+        if (m < count || (first == 0 && !ot_matches(b, t, &input, p, i)))
+            continue;
+        p += 2 * (count - first);
+        if (chained) {
+            n = ot_u16(t, p);
+            for (m = 0, j = pos[count - 1]; m < n; m++) {
+                j = ot_next(b, j, flag, set);
+                if (j < 0 || !ot_matches(b, t, &ahead, p + 2 + 2 * m, j))
+                    break;
+            }
+            if (m < n)
+                continue;
+            p += 2 + 2 * n;
+            n = ot_u16(t, p);
+            p += 2;
+        } else {
+            n = ot_u16(t, (format == 3 ? rule + 2 : p - 2 * (count - first) - 2));
+        }
+        /* |p| is at the lookup records now */
+        for (m = 0; m < n; m++) {
+            unsigned index = ot_u16(t, p + 4 * m);
+            unsigned l = ot_lookup_offset(t, ot_u16(t, p + 4 * m + 2));
+            int size = b->n, dummy, q;
+            if (index >= count || l == 0 || b->depth >= ot_max_depth
+                || pos[index] >= b->n)
+                continue;
+            b->depth++;
+            (void) ot_apply(b, t, gpos, l, pos[index], &dummy);
+            b->depth--;
+            for (q = (int) index + 1; q < (int) count; q++)
+                pos[q] += b->n - size;
+        }
+        *next = pos[count - 1] + 1;
+        if (*next <= i)
+            *next = i + 1;
+        return 1;
+    }
+    return 0;
+}
+
+@ Positioning. Value records hold up to four numbers we use, and four
+device table offsets that we skip.
+
+@c
+static unsigned ot_value_size(unsigned format)
+{
+    unsigned n = 0;
+    for (format &= 0xFF; format != 0; format >>= 1)
+        n += (format & 1);
+    return 2 * n;
+}
+
+static void ot_value(ot_buffer * b, const ot_table * t, unsigned p,
+                     unsigned format, int i)
+{
+    if (format & 0x0001) {
+        b->g[i].x_offset += ot_scale(b, ot_s16(t, p));
+        p += 2;
+    }
+    if (format & 0x0002) {
+        b->g[i].y_offset += ot_scale(b, ot_s16(t, p));
+        p += 2;
+    }
+    if (format & 0x0004)
+        b->g[i].x_advance += ot_scale(b, ot_s16(t, p));
+}
+
+static int ot_single_pos(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                         int i, int *next)
+{
+    unsigned format = ot_u16(t, s + 4);
+    if (ot_u16(t, s) == 1) {
+        ot_value(b, t, s + 6, format, i);
+    } else {
+        if (k >= (int) ot_u16(t, s + 6))
+            return 0;
+        ot_value(b, t, s + 8 + ot_value_size(format) * (unsigned) k, format, i);
+    }
+    *next = i + 1;
+    return 1;
+}
+
+static int ot_pair_pos(ot_buffer * b, const ot_table * t, unsigned s, int k,
+                       int i, unsigned flag, unsigned set, int *next)
+{
+    unsigned f1 = ot_u16(t, s + 4), f2 = ot_u16(t, s + 6);
+    unsigned s1 = ot_value_size(f1), s2 = ot_value_size(f2);
+    unsigned p;
+    int j = ot_next(b, i, flag, set);
+    if (j < 0)
+        return 0;
+    if (ot_u16(t, s) == 1) {
+        unsigned lo = 0, hi, size = 2 + s1 + s2;
+        if (k >= (int) ot_u16(t, s + 8))
+            return 0;
+        p = s + ot_u16(t, s + 10 + 2 * (unsigned) k);
+        hi = ot_u16(t, p);
+        while (lo < hi) {
+            unsigned m = (lo + hi) / 2;
+            int g = (int) ot_u16(t, p + 2 + size * m);
+            if (g == b->g[j].glyph)
+                break;
+            if (g < b->g[j].glyph)
+                lo = m + 1;
+            else
+                hi = m;
+        }
+        if (lo >= hi)
+            return 0;
+        p += 2 + size * ((lo + hi) / 2) + 2;
+    } else if (ot_u16(t, s) == 2) {
+        int c1 = ot_class(t, s + ot_u16(t, s + 8), b->g[i].glyph);
+        int c2 = ot_class(t, s + ot_u16(t, s + 10), b->g[j].glyph);
+        unsigned n1 = ot_u16(t, s + 12), n2 = ot_u16(t, s + 14);
+        if (c1 >= (int) n1 || c2 >= (int) n2)
+            return 0;
+        p = s + 16 + (s1 + s2) * ((unsigned) c1 * n2 + (unsigned) c2);
+    } else {
+        return 0;
+    }
+    ot_value(b, t, p, f1, i);
+    ot_value(b, t, p + s1, f2, j);
+    *next = (f2 != 0 ? j + 1 : j);
+    return 1;
+}
+
+@ A mark is moved so that its anchor falls on the anchor of the glyph it
+attaches to. In the node list the mark comes after that glyph, so the
+advances in between are taken off again. Marks are assumed to have no
+advance of their own (see |ot_zero_marks|).
+
+@c
+static void ot_attach(ot_buffer * b, const ot_table * t, int i, unsigned mark,
+                      int j, unsigned base)
+{
+    scaled d = 0;
+    int k;
+    for (k = j; k < i; k++)
+        d += char_width(b->f, character(b->g[k].node)) + b->g[k].x_advance;
+    b->g[i].x_offset = b->g[j].x_offset - d
+        + ot_scale(b, ot_s16(t, base + 2) - ot_s16(t, mark + 2));
+    b->g[i].y_offset = b->g[j].y_offset
+        + ot_scale(b, ot_s16(t, base + 4) - ot_s16(t, mark + 4));
+}
+
+static int ot_mark_pos(ot_buffer * b, const ot_table * t, unsigned type,
+                       unsigned s, int k, int i, unsigned flag, unsigned set,
+                       int *next)
+{
+    unsigned classes = ot_u16(t, s + 6);
+    unsigned marks = s + ot_u16(t, s + 8);
+    unsigned bases = s + ot_u16(t, s + 10);
+    unsigned c, p, anchor;
+    int j = i, kb;
+    if (k >= (int) ot_u16(t, marks))
+        return 0;
+    c = ot_u16(t, marks + 2 + 4 * (unsigned) k);
+    if (c >= classes)
+        return 0;
+    if (type == 6) {
+        j = ot_prev(b, i, flag, set);
+        if (j < 0 || b->g[j].glyph_class != mark_glyph_class)
+            return 0;
+    } else {
+        do {
+            j--;
+        } while (j >= 0 && b->g[j].glyph_class == mark_glyph_class);
+        if (j < 0)
+            return 0;
+    }
+    kb = ot_coverage(t, s + ot_u16(t, s + 4), b->g[j].glyph);
+    if (kb < 0 || kb >= (int) ot_u16(t, bases))
+        return 0;
+    if (type == 5) {
+        /* attach to the last component of the ligature */
+        unsigned n;
+        p = bases + ot_u16(t, bases + 2 + 2 * (unsigned) kb);
+        n = ot_u16(t, p);
+        if (n == 0)
+            return 0;
+        anchor = ot_u16(t, p + 2 + 2 * ((n - 1) * classes + c));
+    } else {
+        p = bases;
+        anchor = ot_u16(t, p + 2 + 2 * ((unsigned) kb * classes + c));
+    }
+    if (anchor == 0)
+        return 0;
+    ot_attach(b, t, i, marks + ot_u16(t, marks + 2 + 4 * (unsigned) k + 2), j,
+              p + anchor);
+    *next = i + 1;
+    return 1;
+}
+
+@ |ot_apply| tries the subtables of a lookup in turn at position |i|;
+the first one that applies wins.
+
+@c
+static int ot_apply(ot_buffer * b, const ot_table * t, int gpos, unsigned l,
+                    int i, int *next)
+{
+    unsigned flag = ot_lookup_flag(t, l);
+    unsigned n = ot_subtable_count(t, l);
+    unsigned set = 0, k, type, s;
+    int c;
+    if (flag & use_mark_filtering)
+        set = ot_u16(t, l + 6 + 2 * n);
+    if (ot_skip(b, i, flag, set))
+        return 0;
+    for (k = 0; k < n; k++) {
+        s = ot_subtable(t, gpos, l, k, &type);
+        if (gpos ? (type == 7 || type == 8) : (type == 5 || type == 6)) {
+            if (ot_context(b, t, gpos, s, (type == 6 || type == 8), flag, set, i, next))
+                return 1;
+            continue;
+        }
+        c = ot_coverage(t, s + ot_u16(t, s + 2), b->g[i].glyph);
+        if (c < 0)
+            continue;
+        if (gpos) {
+            switch (type) {
+            case 1:
+                if (ot_single_pos(b, t, s, c, i, next))
+                    return 1;
+                break;
+            case 2:
+                if (ot_pair_pos(b, t, s, c, i, flag, set, next))
+                    return 1;
+                break;
+            case 4:
+            case 5:
+            case 6:
+                if (ot_mark_pos(b, t, type, s, c, i, flag, set, next))
+                    return 1;
+                break;
+            }
+        } else {
+            switch (type) {
+            case 1:
+                if (ot_single(b, t, s, c, i, next))
+                    return 1;
+                break;
+            case 2:
+                if (ot_multiple(b, t, s, c, i, next))
+                    return 1;
+                break;
+            case 3:
+                if (ot_alternate(b, t, s, c, i, next))
+                    return 1;
+                break;
+            case 4:
+                if (ot_ligature(b, t, s, c, i, flag, set, next))
+                    return 1;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+@ Before positioning, marks lose their advance width, as in other
+shapers; their place is set by mark attachment.
+
+@c
+static void ot_zero_marks(ot_buffer * b)
+{
+    int i;
+    for (i = 0; i < b->n; i++) {
+        if (b->g[i].glyph_class == mark_glyph_class)
+            b->g[i].x_advance = -char_width(b->f, character(b->g[i].node));
+    }
+}
+
+static void ot_shape_buffer(ot_buffer * b)
+{
+    ot_shaper *sh = b->sh;
+    int k, i, next, positioned = 0;
+    for (k = 0; k < sh->num_lookups; k++) {
+        ot_lookup *lk = sh->lookups + k;
+        const ot_table *t = (lk->gpos ? &sh->gpos : &sh->gsub);
+        if (lk->gpos && !positioned) {
+            ot_zero_marks(b);
+            positioned = 1;
+        }
+        for (i = 0; i < b->n;) {
+            int g = b->g[i].glyph;
+            if (g < sh->num_glyphs && (lk->coverage[g >> 3] & (1 << (g & 7)))
+                && ot_apply(b, t, lk->gpos, lk->offset, i, &next))
+                i = next;
+            else
+                i++;
+        }
+    }
+}
+
+@ |ot_shape_run| shapes the glyphs from |first| up to the next node that
+is not a shapable glyph of the same font, and links the result in after
+|prev|. It returns the last node it linked.
+
+@c
+static int ot_shapable(halfword p)
+{
+    return (type(p) == glyph_node && is_simple_character(p)
+            && font_shaper(font(p)) != NULL);
+}
+
+static halfword ot_shape_run(halfword prev, halfword first)
+{
+    ot_buffer *b = &ot_buf;
+    internal_font_number f = font(first);
+    halfword p = first, rest;
+    int i;
+    b->f = f;
+    b->sh = font_shaper(f);
+    b->n = 0;
+    b->depth = 0;
+    while (p != null && ot_shapable(p) && font(p) == f) {
+        int g = char_index(f, character(p));
+        ot_buffer_room(b, 1);
+        b->g[b->n].node = p;
+        b->g[b->n].glyph = (g > 0 ? g : 0);
+        b->g[b->n].glyph_class = ot_glyph_class(b->sh, b->g[b->n].glyph);
+        b->g[b->n].x_offset = 0;
+        b->g[b->n].y_offset = 0;
+        b->g[b->n].x_advance = 0;
+        b->n++;
+        p = vlink(p);
+    }
+    rest = p;
+    ot_shape_buffer(b);
+    for (i = 0; i < b->n; i++) {
+        p = b->g[i].node;
+        set_is_glyph(p);
+        x_displace(p) += b->g[i].x_offset;
+        y_displace(p) += b->g[i].y_offset;
+        couple_nodes(prev, p);
+        prev = p;
+        if (b->g[i].x_advance != 0) {
+            halfword k = new_kern(b->g[i].x_advance);
+            delete_attribute_ref(node_attr(k));
+            add_node_attr_ref(node_attr(p));
+            node_attr(k) = node_attr(p);
+            couple_nodes(prev, k);
+            prev = k;
+        }
+    }
+    try_couple_nodes(prev, rest);
+    return prev;
+}
+
+@ Runs are shaped in the list after |head| and in the three lists of
+discretionaries; shaping does not look across their borders.
+
+@c
+static halfword shape_list(halfword head)
+{
+    halfword prev = head;
+    halfword cur = vlink(head);
+    while (cur != null) {
+        if (ot_shapable(cur)) {
+            prev = ot_shape_run(prev, cur);
+        } else {
+            if (type(cur) == disc_node) {
+                if (vlink_pre_break(cur) != null)
+                    tlink_pre_break(cur) = shape_list(pre_break(cur));
+                if (vlink_post_break(cur) != null)
+                    tlink_post_break(cur) = shape_list(post_break(cur));
+                if (vlink_no_break(cur) != null)
+                    tlink_no_break(cur) = shape_list(no_break(cur));
+            }
+            prev = cur;
+        }
+        cur = vlink(prev);
+    }
+    return prev;
+}
+
+@ Like |handle_kerning|, this returns the new tail; |head| should be a
+dummy.
+
+@c
+halfword handle_shaping(halfword head, halfword tail)
+{
+    halfword save_link;
+    if (ot_shaper_count == 0 || vlink(head) == null)
+        return tail;
+    save_link = vlink(tail);
+    vlink(tail) = null;
+    tail = shape_list(head);
+    if (valid_node(save_link)) {
+        try_couple_nodes(tail, save_link);
+    }
+    return tail;
+}
+
 @* ligaturing and kerning : lua-interface.
 
 @c
@@ -2290,6 +3506,7 @@ halfword new_ligkern(halfword head, halfword tail)
         if (tail == null)
             tail = tail_of_list(head);
     } else if (callback_id == 0) {
+        tail = handle_shaping(head, tail);
         tail = handle_ligaturing(head, tail);
     }
 
@@ -191,6 +191,7 @@ void write_fontencodings(PDF pdf);
 
 /* writettf.c */
 void writettf(PDF, fd_entry *);
+void ttf_forget_font_file(void);
 void writeotf(PDF, fd_entry *);
 void ttf_free(void);
 extern int ttf_length;
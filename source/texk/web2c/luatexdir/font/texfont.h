@@ -171,6 +171,14 @@ typedef struct texfont {
 
     int _pdf_font_num;          /* maps to a PDF resource ID */
     str_number _pdf_font_attr;  /* pointer to additional attributes */
+
+    unsigned int *used_chars;   /* bitset of the characters marked as used */
+    int used_chars_size;        /* number of words in |used_chars| */
+
+    struct ot_shaper *_font_shaper;     /* OpenType lookups, see |handle_shaping| */
+
+    int _font_shared;           /* the font whose character data is used, see |scale_font| */
+    int _font_instances;        /* number of fonts that use this font's character data */
 } texfont;
 
 typedef enum {
@@ -212,6 +220,11 @@ extern const char *font_embedding_strings[];
 #  define font_dsize(a)             font_tables[a]->_font_dsize
 #  define set_font_dsize(a,b)       font_dsize(a) = b
 
+#  define font_shaper(a)            font_tables[a]->_font_shaper
+
+#  define font_shared(a)            font_tables[a]->_font_shared
+#  define font_instances(a)         font_tables[a]->_font_instances
+
 #  define font_units_per_em(a)             font_tables[a]->_font_units_per_em
 #  define set_font_units_per_em(a,b)       font_units_per_em(a) = b
 
@@ -439,10 +452,20 @@ extern void add_charinfo_math_kern(charinfo * ci, int type, scaled ht,
 extern int get_charinfo_math_kerns(charinfo * ci, int id);
 
 #  define set_char_used(f,a,b)  do {                            \
-        if (char_exists(f,a))                                   \
-            set_charinfo_used(char_info(f,a),b);                \
+        if (char_exists(f,a)) {                                 \
+            if (!font_shared(f))                                \
+                set_charinfo_used(char_info(f,a),b);            \
+            set_font_used_char(f,a,b);                          \
+        }                                                       \
     } while (0)
 
+extern void set_font_used_char(internal_font_number f, int c, int b);
+extern int next_used_char(internal_font_number f, int c);
+
+/* Loop over the used characters of font |f| in ascending order. */
+#  define for_each_used_char(f,c) \
+    for (c = next_used_char(f, 0); c >= 0; c = next_used_char(f, c + 1))
+
 extern scaled get_charinfo_width(charinfo * ci);
 extern scaled get_charinfo_height(charinfo * ci);
 extern scaled get_charinfo_depth(charinfo * ci);
@@ -549,6 +572,8 @@ int new_font(void);
 extern void font_malloc_charinfo(internal_font_number f, int num);
 int copy_font(int id);
 int scale_font(int id, int atsize);
+extern scaled shared_font_scaled(internal_font_number f, scaled v);
+#  define char_scaled(f,v) (font_shared(f) ? shared_font_scaled(f,v) : (v))
 int max_font_id(void);
 void set_max_font_id(int id);
 int new_font_id(void);
@@ -559,6 +584,9 @@ boolean is_valid_font(int id);
 void dump_font(int font_number);
 void undump_font(int font_number);
 
+extern const char *save_font_cache(internal_font_number f, const char *filename);
+extern int load_font_cache(const char *filename);
+
 int test_no_ligatures(internal_font_number f);
 void set_no_ligatures(internal_font_number f);
 
@@ -574,6 +602,35 @@ extern void set_ef_code(internal_font_number f, int c, int i);
 
 int read_tfm_info(internal_font_number f, const char *nom, scaled s);
 
+/* from luafont.c */
+
+typedef struct ot_shaper ot_shaper;
+
+typedef struct {
+    unsigned char *data;
+    unsigned len;
+} ot_table;
+
+extern ot_shaper *new_ot_shaper(internal_font_number f, ot_table * gsub,
+                                ot_table * gpos, ot_table * gdef,
+                                int num_glyphs, int units_per_em,
+                                const char *script, const char *language,
+                                const char **features, int num_features,
+                                int alternate);
+extern int ot_shaper_lookups(ot_shaper * s);
+extern ot_shaper *share_ot_shaper(ot_shaper * s);
+extern void release_ot_shaper(ot_shaper * s);
+extern void set_font_shaper(internal_font_number f, ot_shaper * s);
+
+typedef struct {
+    char script[4];
+    char language[4];
+    char feature[4];
+} ot_feature_tag;
+
+extern int ot_feature_list(const ot_table * t, ot_feature_tag ** list);
+extern int ot_gdef_glyph_class(const ot_table * gdef, int g);
+
 
 /* from dofont.c */
 
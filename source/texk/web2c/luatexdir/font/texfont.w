@@ -344,9 +344,74 @@ scaled_whd get_charinfo_whd(internal_font_number f, int c)
     s.wd = i->width;
     s.dp = i->depth;
     s.ht = i->height;
+    if (font_shared(f)) {
+        s.wd = shared_font_scaled(f, s.wd);
+        s.dp = shared_font_scaled(f, s.dp);
+        s.ht = shared_font_scaled(f, s.ht);
+    }
     return s;
 }
 
+@ Besides the |used| flag in |charinfo|, every font keeps a bitset of its
+used characters, so that the font writers can enumerate them without
+looking up every character between |font_bc| and |font_ec|. The bitset
+covers the proper character range only and grows on demand.
+
+@c
+#define used_chars_bits (8 * (int) sizeof(unsigned int))
+
+void set_font_used_char(internal_font_number f, int c, int b)
+{
+    texfont *tf = font_tables[f];
+    int w;
+    if (!proper_char_index(c))
+        return;
+    w = c / used_chars_bits;
+    if (w >= tf->used_chars_size) {
+        int n;
+        if (!b)
+            return;
+        n = (font_ec(f) > c ? font_ec(f) : c) / used_chars_bits + 1;
+        tf->used_chars = xreallocarray(tf->used_chars, unsigned int, (unsigned) n);
+        memset(tf->used_chars + tf->used_chars_size, 0,
+               (size_t) (n - tf->used_chars_size) * sizeof(unsigned int));
+        tf->used_chars_size = n;
+    }
+    if (b)
+        tf->used_chars[w] |= 1U << (c % used_chars_bits);
+    else
+        tf->used_chars[w] &= ~(1U << (c % used_chars_bits));
+}
+
+@ Return the first used character of font |f| that is not below |c|, or
+$-1$ if there is none. Whole words of unused characters are skipped at once.
+
+@c
+int next_used_char(internal_font_number f, int c)
+{
+    texfont *tf = font_tables[f];
+    int w = c / used_chars_bits;
+    unsigned int bits;
+    if (c < 0 || w >= tf->used_chars_size)
+        return -1;
+    bits = tf->used_chars[w] & (~0U << (c % used_chars_bits));
+    while (bits == 0) {
+        if (++w == tf->used_chars_size)
+            return -1;
+        bits = tf->used_chars[w];
+    }
+#if defined(__GNUC__)
+    return w * used_chars_bits + __builtin_ctz(bits);
+#else
+    c = w * used_chars_bits;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        c++;
+    }
+    return c;
+#endif
+}
+
 @ @c
 int char_exists(internal_font_number f, int c)
 {
@@ -734,8 +799,8 @@ static void dump_math_kerns(charinfo * ci)
     l = ci->top_right_math_kerns;
     dump_int(l);
     for (k = 0; k < l; k++) {
-        dump_int(ci->bottom_left_math_kern_array[(2 * k)]);
-        dump_int(ci->bottom_left_math_kern_array[(2 * k) + 1]);
+        dump_int(ci->top_right_math_kern_array[(2 * k)]);
+        dump_int(ci->top_right_math_kern_array[(2 * k) + 1]);
     }
 }
 
@@ -945,17 +1010,28 @@ extinfo *get_charinfo_hor_variants(charinfo * ci)
 }
 
 
+@ A font made by |scale_font| has no character data of its own: it uses the
+data of the font it was scaled from, so its dimensions are scaled on access.
+
+@c
+scaled shared_font_scaled(internal_font_number f, scaled v)
+{
+    double d = (double) v * (double) font_size(f) /
+        (double) font_size(font_shared(f));
+    return (scaled) (d < 0.0 ? d - 0.5 : d + 0.5);
+}
+
 scaled char_width(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
     scaled w = get_charinfo_width(ci);
-    return w;
+    return char_scaled(f, w);
 }
 
 scaled calc_char_width(internal_font_number f, int c, int ex)
 {
     charinfo *ci = char_info(f, c);
-    scaled w = get_charinfo_width(ci);
+    scaled w = char_scaled(f, get_charinfo_width(ci));
     //printf("ex=%d\n",ex);
     if (ex != 0) 
         w = round_xn_over_d(w, 1000 + ex, 1000);
@@ -966,32 +1042,32 @@ scaled char_depth(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
     scaled w = get_charinfo_depth(ci);
-    return w;
+    return char_scaled(f, w);
 }
 
 scaled char_height(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
     scaled w = get_charinfo_height(ci);
-    return w;
+    return char_scaled(f, w);
 }
 
 scaled char_italic(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
-    return get_charinfo_italic(ci);
+    return char_scaled(f, get_charinfo_italic(ci));
 }
 
 scaled char_top_accent(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
-    return get_charinfo_top_accent(ci);
+    return char_scaled(f, get_charinfo_top_accent(ci));
 }
 
 scaled char_bot_accent(internal_font_number f, int c)
 {
     charinfo *ci = char_info(f, c);
-    return get_charinfo_bot_accent(ci);
+    return char_scaled(f, get_charinfo_bot_accent(ci));
 }
 
 
@@ -1009,7 +1085,10 @@ char char_tag(internal_font_number f, int c)
 
 char char_used(internal_font_number f, int c)
 {
-    charinfo *ci = char_info(f, c);
+    charinfo *ci;
+    if (font_shared(f))         /* the |used| flag belongs to the shared data */
+        return (char) (proper_char_index(c) && next_used_char(f, c) == c);
+    ci = char_info(f, c);
     return get_charinfo_used(ci);
 }
 
@@ -1082,7 +1161,29 @@ void set_font_math_params(internal_font_number f, int b)
 }
 
 
-@ @c
+@ When an instance of a shared font is copied, the copy gets character
+data of its own, at its own size.
+
+@c
+static void scale_shared_charinfo(internal_font_number f, charinfo * ci)
+{
+    kerninfo *kern;
+    if (ci == NULL)
+        return;
+    ci->width = shared_font_scaled(f, ci->width);
+    ci->height = shared_font_scaled(f, ci->height);
+    ci->depth = shared_font_scaled(f, ci->depth);
+    ci->italic = shared_font_scaled(f, ci->italic);
+    ci->top_accent = shared_font_scaled(f, ci->top_accent);
+    ci->bot_accent = shared_font_scaled(f, ci->bot_accent);
+    if ((kern = get_charinfo_kerns(ci)) != NULL) {
+        while (!kern_end(*kern)) {
+            kern_kern(*kern) = shared_font_scaled(f, kern_kern(*kern));
+            kern++;
+        }
+    }
+}
+
 int copy_font(int f)
 {
     int i, ci_cnt, ci_size;
@@ -1097,6 +1198,9 @@ int copy_font(int f)
         font_tables[k]->charinfo = ci;
         font_tables[k]->charinfo_count = ci_cnt;
         font_tables[k]->charinfo_size = ci_size;
+        font_tables[k]->used_chars = NULL;      /* |copy_charinfo| clears the flags */
+        font_tables[k]->used_chars_size = 0;
+        font_tables[k]->_font_shaper = share_ot_shaper(font_shaper(f));
     }
 
     font_malloc_charinfo(k, font_tables[f]->charinfo_count);
@@ -1160,16 +1264,150 @@ int copy_font(int f)
     }
     /* not updated yet: */
     font_tables[k]->charinfo_count = font_tables[f]->charinfo_count;
+    font_tables[k]->_font_instances = 0;
+    if (font_shared(f)) {
+        for (i = 0; i <= font_tables[k]->charinfo_count; i++)
+            scale_shared_charinfo(f, &font_tables[k]->charinfo[i]);
+        scale_shared_charinfo(f, left_boundary(k));
+        scale_shared_charinfo(f, right_boundary(k));
+        font_shared(k) = 0;
+    }
+    return k;
+}
+
+@ |scale_font| makes a new instance of font |f| at size |atsize| that owns
+nothing but its parameters: characters, kerns and ligatures stay with |f|,
+and |char_width| and friends scale them on access. This saves a complete
+copy of the character data for every size at which a font is used.
+The instance rounds a second time, so a shared font is best defined at
+a large size.
+
+Math fonts and virtual fonts are not shared, because the math extensibles
+and the character packets carry dimensions that are read directly. Fonts
+that share data can not be changed by |font.setfont| anymore.
+
+@c
+int scale_font(int f, int atsize)
+{
+    int i, k;
+    texfont *tf;
+    if (font_shared(f))
+        f = font_shared(f);
+    if (font_type(f) == virtual_font_type || font_math_params(f) > 0
+        || atsize <= 0 || font_size(f) <= 0)
+        return 0;
+    k = new_font();
+    tf = font_tables[k];
+    /* drop what |new_font| made, it comes from |f| */
+    destroy_sa_tree(tf->characters);
+    set_charinfo_name(tf->charinfo, NULL);
+    free(tf->charinfo);
+    free(tf->_param_base);
+    memcpy(tf, font_tables[f], sizeof(texfont));
+
+    tf->_font_shared = f;
+    tf->_font_instances = 0;
+    font_instances(f)++;
+    tf->used_chars = NULL;
+    tf->used_chars_size = 0;
+    tf->_font_shaper = share_ot_shaper(font_shaper(f));
+    set_font_size(k, atsize);
+    set_font_cache_id(k, 0);
+    set_font_used(k, 0);
+    set_font_touched(k, 0);
+    set_pdf_font_num(k, 0);
+
+    tf->_font_name = NULL;
+    tf->_font_filename = NULL;
+    tf->_font_fullname = NULL;
+    tf->_font_psname = NULL;
+    tf->_font_encodingname = NULL;
+    tf->_font_area = NULL;
+    tf->_font_cidregistry = NULL;
+    tf->_font_cidordering = NULL;
+    set_font_name(k, xstrdup(font_name(f)));
+    if (font_filename(f) != NULL)
+        set_font_filename(k, xstrdup(font_filename(f)));
+    if (font_fullname(f) != NULL)
+        set_font_fullname(k, xstrdup(font_fullname(f)));
+    if (font_psname(f) != NULL)
+        set_font_psname(k, xstrdup(font_psname(f)));
+    if (font_encodingname(f) != NULL)
+        set_font_encodingname(k, xstrdup(font_encodingname(f)));
+    if (font_area(f) != NULL)
+        set_font_area(k, xstrdup(font_area(f)));
+    if (font_cidregistry(f) != NULL)
+        set_font_cidregistry(k, xstrdup(font_cidregistry(f)));
+    if (font_cidordering(f) != NULL)
+        set_font_cidordering(k, xstrdup(font_cidordering(f)));
+
+    /* the slant is the only parameter that is not a dimension */
+    i = (int) (sizeof(*param_base(f)) * (unsigned) (font_params(f)+1));
+    param_base(k) = xmalloc((unsigned) (i+1));
+    memcpy(param_base(k), param_base(f), (size_t) (i));
+    for (i = space_code; i <= font_params(k); i++)
+        set_font_param(k, i, shared_font_scaled(k, font_param(f, i)));
     return k;
 }
 
+@ Turn an instance made by |scale_font| into an ordinary font, for
+|dump_font|.
+
+@c
+static void unshare_font(internal_font_number k)
+{
+    int i, f = font_shared(k);
+    texfont *tf = font_tables[k];
+    charinfo *ci;
+    if (f == 0)
+        return;
+    tf->characters = copy_sa_tree(font_tables[f]->characters);
+    tf->charinfo = xcalloc((unsigned) tf->charinfo_size, sizeof(charinfo));
+    font_bytes += (int) (tf->charinfo_size * (int) sizeof(charinfo));
+    for (i = 0; i <= tf->charinfo_count; i++) {
+        ci = copy_charinfo(&font_tables[f]->charinfo[i]);
+        scale_shared_charinfo(k, ci);
+        tf->charinfo[i] = *ci;
+        xfree(ci);
+    }
+    tf->_left_boundary = copy_charinfo(left_boundary(f));
+    tf->_right_boundary = copy_charinfo(right_boundary(f));
+    scale_shared_charinfo(k, left_boundary(k));
+    scale_shared_charinfo(k, right_boundary(k));
+    for_each_used_char(k, i) {
+        set_charinfo_used(char_info(k, i), true);
+    }
+    font_instances(f)--;
+    font_shared(k) = 0;
+}
+
 @ @c
 void delete_font(int f)
 {
     int i;
     charinfo *co;
     assert(f > 0);
-    if (font_tables[f] != NULL) {
+    if (font_tables[f] != NULL && font_instances(f) > 0)
+        return;                 /* still in use by |scale_font| instances */
+    if (font_tables[f] != NULL && font_shared(f)) {
+        set_font_name(f, NULL);
+        set_font_filename(f, NULL);
+        set_font_fullname(f, NULL);
+        set_font_psname(f, NULL);
+        set_font_encodingname(f, NULL);
+        set_font_area(f, NULL);
+        set_font_cidregistry(f, NULL);
+        set_font_cidordering(f, NULL);
+        font_instances(font_shared(f))--;
+        free(param_base(f));
+        xfree(font_tables[f]->used_chars);
+        release_ot_shaper(font_shaper(f));
+        free(font_tables[f]);
+        font_tables[f] = NULL;
+        if (font_id_maxval == f) {
+            font_id_maxval--;
+        }
+    } else if (font_tables[f] != NULL) {
         set_font_name(f, NULL);
         set_font_filename(f, NULL);
         set_font_fullname(f, NULL);
@@ -1201,6 +1439,8 @@ void delete_font(int f)
         free(param_base(f));
         if (math_param_base(f) != NULL)
             free(math_param_base(f));
+        xfree(font_tables[f]->used_chars);
+        release_ot_shaper(font_shaper(f));
         free(font_tables[f]);
         font_tables[f] = NULL;
 
@@ -1422,7 +1662,7 @@ scaled raw_get_kern(internal_font_number f, int lc, int rc)
             if (kern_disabled(u))
                 return 0;
             else
-                return kern_kern(u);
+                return char_scaled(f, kern_kern(u));
         }
         k++;
     }
@@ -1552,6 +1792,7 @@ void dump_font(int f)
 {
     int i, x;
 
+    unshare_font(f);
     set_font_used(f, 0);
     font_tables[f]->charinfo_cache = NULL;
     dump_font_entry(font_tables[f]);
@@ -1776,3 +2017,147 @@ void undump_font(int f)
         i = undump_charinfo(f);
     }
 }
+
+@ A font can also be written to a cache file of its own, so that a later run
+gets it back without building and ingesting its Lua table again. The file
+holds exactly what |dump_font| puts into a format, preceded by a header that
+rejects files written by another build or for another format layout, and
+followed by the \.{attributes} string, because its string number means
+nothing in another run. The last item is the number of bytes between the
+header and itself.
+
+Only real fonts that have not been used yet can be cached: the packets of a
+virtual font refer to the ids of other fonts, and dumping clears the `used'
+flags of the characters.
+
+@c
+#define font_cache_magic "LuaTeX font cache 2\n"
+#define font_cache_header_size 7
+
+static int font_cache_header[font_cache_header_size];
+
+static void set_font_cache_header(void)
+{
+    font_cache_header[0] = luatex_version;
+    font_cache_header[1] = luatex_revision;
+    font_cache_header[2] = FORMAT_ID;
+    font_cache_header[3] = (int) sizeof(charinfo);
+    font_cache_header[4] = (int) sizeof(liginfo);
+    font_cache_header[5] = (int) sizeof(kerninfo);
+    font_cache_header[6] = (int) sizeof(scaled);
+}
+
+const char *save_font_cache(internal_font_number f, const char *filename)
+{
+    int x;
+    long start;
+    char *s;
+    char *tmpname;
+    char magic[] = font_cache_magic;
+    if (font_type(f) == virtual_font_type)
+        return "virtual fonts can't be cached";
+    if (font_used(f))
+        return "the font has been used already";
+    tmpname = xmalloc((unsigned) (strlen(filename) + 5));
+    sprintf(tmpname, "%s.tmp", filename);
+    if (!zopen_font_file(tmpname, "wb1")) {
+        xfree(tmpname);
+        return "the cache file can't be opened";
+    }
+    set_font_cache_header();
+    dump_things(*magic, strlen(magic));
+    dump_things(font_cache_header[0], font_cache_header_size);
+    start = ztell_font_file();
+    dump_font(f);
+    s = (pdf_font_attr(f) != 0 ? makecstring(pdf_font_attr(f)) : NULL);
+    dump_string(s);
+    xfree(s);
+    dump_int((int) (ztell_font_file() - start));
+    if (!zclose_font_file() || rename(tmpname, filename) != 0) {
+        remove(tmpname);
+        xfree(tmpname);
+        return "the cache file can't be written";
+    }
+    xfree(tmpname);
+    return NULL;
+}
+
+@ The undumping routines stop the run when the data runs out, so the file is
+checked before anything is undumped: the header is read directly, and the
+rest is read once to see that it decompresses and that its length matches
+the last item. A bad or foreign file thus gives a soft error; beyond that,
+the cache file is trusted as much as a format.
+
+@c
+static boolean open_font_cache(const char *filename)
+{
+    int k, x;
+    char magic[sizeof(font_cache_magic)];
+    int header[font_cache_header_size];
+    if (!zopen_font_file(filename, "rb"))
+        return false;
+    set_font_cache_header();
+    x = (int) strlen(font_cache_magic);
+    if (zread_font_file(magic, x) != x
+        || strncmp(magic, font_cache_magic, (size_t) x) != 0
+        || zread_font_file(header, (int) sizeof(header)) != (int) sizeof(header)) {
+        zclose_font_file();
+        return false;
+    }
+#if !defined (WORDS_BIGENDIAN) && !defined (NO_DUMP_SHARE)
+    for (k = 0; k < font_cache_header_size; k++) {
+        unsigned u = (unsigned) header[k];
+        header[k] = (int) ((u >> 24) | ((u >> 8) & 0xFF00) | ((u << 8) & 0xFF0000) | (u << 24));
+    }
+#endif
+    if (memcmp(header, font_cache_header, sizeof(header)) != 0) {
+        zclose_font_file();
+        return false;
+    }
+    return true;
+}
+
+static boolean check_font_cache(const char *filename)
+{
+    char buf[8192];
+    unsigned char last[4] = { 0, 0, 0, 0 };
+    long len = 0;
+    int n;
+    if (!open_font_cache(filename))
+        return false;
+    while ((n = zread_font_file(buf, (int) sizeof(buf))) > 0) {
+        if (n >= 4) {
+            memcpy(last, buf + n - 4, 4);
+        } else {
+            memmove(last, last + n, (size_t) (4 - n));
+            memcpy(last + 4 - n, buf, (size_t) n);
+        }
+        len += n;
+    }
+    zclose_font_file();
+    return (n == 0 && len >= 4 && len - 4 ==
+            (long) (((unsigned long) last[0] << 24) | ((unsigned long) last[1] << 16)
+                    | ((unsigned long) last[2] << 8) | last[3]));
+}
+
+int load_font_cache(const char *filename)
+{
+    int f, x;
+    char *s = NULL;
+    if (!check_font_cache(filename) || !open_font_cache(filename))
+        return 0;
+    f = new_font_id();
+    undump_font(f);
+    undump_int(x);
+    if (x > 0) {
+        s = xmalloc((unsigned) x);
+        undump_things(*s, x);
+    }
+    zclose_font_file();
+    set_font_cache_id(f, 0);
+    set_font_touched(f, 0);
+    set_pdf_font_num(f, 0);
+    set_pdf_font_attr(f, (s != NULL ? maketexstring(s) : 0));
+    xfree(s);
+    return f;
+}
@@ -501,8 +501,8 @@ int write_cid_tounicode(PDF pdf, fo_entry * fo, internal_font_number f)
     }
     for (k = 1; k <= max_font_id(); k++) {
         if (k == f || -f == pdf_font_num(k)) {
-            for (i = font_bc(k); i <= font_ec(k); i++) {
-                if (quick_char_exists(k, i) && char_used(k, i)) {
+            for_each_used_char(k, i) {
+                if (i <= font_ec(k) && quick_char_exists(k, i)) {
                     j = char_index(k, i);
                     if (gtab[j].code == UNI_UNDEF) {
                         set_cid_glyph_unicode(i, &gtab[j], f);
@@ -156,6 +156,18 @@ struct tt_longMetrics {
 };
 
 
+/* cmap, as a sorted array of code/glyph pairs */
+struct tt_cmap_entry {
+    ULONG code;
+    USHORT gid;
+};
+
+struct tt_cmap {
+    ULONG num;
+    ULONG max;
+    struct tt_cmap_entry *entries;
+};
+
 /* head, hhea, maxp */
 extern char *tt_pack_head_table(struct tt_head_table *table);
 extern struct tt_head_table *tt_read_head_table(sfnt * sfont);
@@ -179,6 +191,11 @@ extern struct tt_longMetrics *tt_read_longMetrics(sfnt * sfont,
 /* OS/2 table */
 extern struct tt_os2__table *tt_read_os2__table(sfnt * sfont);
 
+/* cmap table */
+extern struct tt_cmap *tt_read_cmap_table(sfnt * sfont);
+extern USHORT tt_cmap_lookup(struct tt_cmap *cmap, ULONG code);
+extern void tt_release_cmap(struct tt_cmap *cmap);
+
 /* name table */
 extern USHORT tt_get_name(sfnt * sfont, char *dest, USHORT destlen,
                           USHORT plat_id, USHORT enco_id,
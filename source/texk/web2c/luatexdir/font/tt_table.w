@@ -373,9 +373,13 @@ struct tt_os2__table *tt_read_os2__table(sfnt * sfont)
     table->sTypoLineGap = sfnt_get_short(sfont);
     table->usWinAscent = sfnt_get_ushort(sfont);
     table->usWinDescent = sfnt_get_ushort(sfont);
-    table->ulCodePageRange1 = sfnt_get_ulong(sfont);
-    table->ulCodePageRange2 = sfnt_get_ulong(sfont);
-    if (table->version == 0x0002) {
+    table->ulCodePageRange1 = 0;
+    table->ulCodePageRange2 = 0;
+    if (table->version >= 0x0001) {     /* version~0 tables end here */
+        table->ulCodePageRange1 = sfnt_get_ulong(sfont);
+        table->ulCodePageRange2 = sfnt_get_ulong(sfont);
+    }
+    if (table->version >= 0x0002) {
         table->sxHeight = sfnt_get_short(sfont);
         table->sCapHeight = sfnt_get_short(sfont);
         table->usDefaultChar = sfnt_get_ushort(sfont);
@@ -386,6 +390,196 @@ struct tt_os2__table *tt_read_os2__table(sfnt * sfont)
     return table;
 }
 
+@ cmap table
+
+Only the Unicode subtables are used. A format~12 subtable covers the whole
+repertoire and is preferred; otherwise the format~4 (BMP) subtable is taken,
+and a Windows symbol subtable as a last resort. The mapping is kept as an
+array of code/glyph pairs sorted on code: even for the big CJK fonts that is
+a lot smaller than a table per character, and |tt_cmap_lookup| can do a
+binary search in it.
+
+The subtable lengths are checked against the table length, so a damaged
+table results in a short (or empty) mapping rather than in reading beyond
+the end of the font.
+
+@c
+static int tt_compare_cmap_entries(const void *a, const void *b)
+{
+    const struct tt_cmap_entry *p = a, *q = b;
+    if (p->code != q->code)
+        return (p->code < q->code ? -1 : 1);
+    return (p->gid < q->gid ? -1 : (p->gid > q->gid ? 1 : 0));
+}
+
+static void tt_add_cmap_entry(struct tt_cmap *cmap, ULONG code, USHORT gid)
+{
+    if (gid == 0)
+        return;
+    if (cmap->num == cmap->max) {
+        cmap->max = (cmap->max == 0 ? 256 : 2 * cmap->max);
+        cmap->entries = RENEW(cmap->entries, cmap->max, struct tt_cmap_entry);
+    }
+    cmap->entries[cmap->num].code = code;
+    cmap->entries[cmap->num].gid = gid;
+    cmap->num++;
+}
+
+static void tt_read_cmap4(sfnt * sfont, struct tt_cmap *cmap, ULONG offset,
+                          ULONG length)
+{
+    USHORT segcount, seg, c, gid;
+    USHORT start, end, range;
+    SHORT delta;
+    ULONG ends, starts, deltas, ranges, p;
+    sfnt_seek_set(sfont, (long) (offset + 6));
+    segcount = (USHORT) (sfnt_get_ushort(sfont) / 2);
+    ends = offset + 14;
+    starts = ends + 2 * (ULONG) segcount + 2;
+    deltas = starts + 2 * (ULONG) segcount;
+    ranges = deltas + 2 * (ULONG) segcount;
+    if (ranges + 2 * (ULONG) segcount > offset + length)
+        return;
+    for (seg = 0; seg < segcount; seg++) {
+        sfnt_seek_set(sfont, (long) (ends + 2 * (ULONG) seg));
+        end = sfnt_get_ushort(sfont);
+        sfnt_seek_set(sfont, (long) (starts + 2 * (ULONG) seg));
+        start = sfnt_get_ushort(sfont);
+        sfnt_seek_set(sfont, (long) (deltas + 2 * (ULONG) seg));
+        delta = sfnt_get_short(sfont);
+        sfnt_seek_set(sfont, (long) (ranges + 2 * (ULONG) seg));
+        range = sfnt_get_ushort(sfont);
+        if (start > end || start == 0xFFFF)
+            continue;
+        for (c = start;; c++) {
+            if (range == 0) {
+                gid = (USHORT) (c + delta);
+            } else {
+                p = ranges + 2 * (ULONG) seg + range + 2 * (ULONG) (c - start);
+                if (p + 2 > offset + length)
+                    break;
+                sfnt_seek_set(sfont, (long) p);
+                gid = sfnt_get_ushort(sfont);
+                if (gid != 0)
+                    gid = (USHORT) (gid + delta);
+            }
+            tt_add_cmap_entry(cmap, c, gid);
+            if (c == end)
+                break;
+        }
+    }
+}
+
+static void tt_read_cmap12(sfnt * sfont, struct tt_cmap *cmap, ULONG offset,
+                           ULONG length)
+{
+    ULONG groups, i, start, end, gid, c;
+    sfnt_seek_set(sfont, (long) (offset + 12));
+    groups = sfnt_get_ulong(sfont);
+    if (groups > (length - 16) / 12)
+        return;
+    for (i = 0; i < groups; i++) {
+        start = sfnt_get_ulong(sfont);
+        end = sfnt_get_ulong(sfont);
+        gid = sfnt_get_ulong(sfont);
+        if (start > end || end > 0x10FFFF)
+            continue;
+        for (c = start; c <= end && gid + (c - start) <= 0xFFFF; c++)
+            tt_add_cmap_entry(cmap, c, (USHORT) (gid + (c - start)));
+    }
+}
+
+struct tt_cmap *tt_read_cmap_table(sfnt * sfont)
+{
+    struct tt_cmap *cmap;
+    ULONG table, length, offset, sublength;
+    ULONG found4 = 0, found12 = 0, foundsym = 0;
+    USHORT num, i, plat_id, enco_id, format;
+
+    cmap = NEW(1, struct tt_cmap);
+    cmap->num = 0;
+    cmap->max = 0;
+    cmap->entries = NULL;
+
+    table = sfnt_find_table_pos(sfont, "cmap");
+    length = sfnt_find_table_len(sfont, "cmap");
+    if (table == 0 || length < 4)
+        return cmap;
+    sfnt_seek_set(sfont, (long) (table + 2));
+    num = sfnt_get_ushort(sfont);
+    if (4 + 8 * (ULONG) num > length)
+        return cmap;
+    for (i = 0; i < num; i++) {
+        sfnt_seek_set(sfont, (long) (table + 4 + 8 * (ULONG) i));
+        plat_id = sfnt_get_ushort(sfont);
+        enco_id = sfnt_get_ushort(sfont);
+        offset = sfnt_get_ulong(sfont);
+        if (offset + 8 > length)
+            continue;
+        sfnt_seek_set(sfont, (long) (table + offset));
+        format = sfnt_get_ushort(sfont);
+        if (plat_id == 0 || (plat_id == 3 && (enco_id == 1 || enco_id == 10))) {
+            if (format == 12 && found12 == 0)
+                found12 = offset;
+            else if (format == 4 && found4 == 0)
+                found4 = offset;
+        } else if (plat_id == 3 && enco_id == 0 && format == 4) {
+            foundsym = offset;
+        }
+    }
+    if (found12 > 0) {
+        sfnt_seek_set(sfont, (long) (table + found12 + 4));
+        sublength = sfnt_get_ulong(sfont);
+        if (sublength >= 16 && found12 + sublength <= length)
+            tt_read_cmap12(sfont, cmap, table + found12, sublength);
+    }
+    if (cmap->num == 0 && (found4 > 0 || foundsym > 0)) {
+        offset = (found4 > 0 ? found4 : foundsym);
+        sfnt_seek_set(sfont, (long) (table + offset + 2));
+        sublength = sfnt_get_ushort(sfont);
+        if (sublength >= 16 && offset + sublength <= length)
+            tt_read_cmap4(sfont, cmap, table + offset, sublength);
+    }
+    if (cmap->num > 1) {
+        ULONG j, k;
+        qsort(cmap->entries, cmap->num, sizeof(struct tt_cmap_entry),
+              tt_compare_cmap_entries);
+        for (k = 1, j = 1; j < cmap->num; j++) {
+            if (cmap->entries[j].code != cmap->entries[k - 1].code)
+                cmap->entries[k++] = cmap->entries[j];
+        }
+        cmap->num = k;
+    }
+    return cmap;
+}
+
+@ @c
+USHORT tt_cmap_lookup(struct tt_cmap * cmap, ULONG code)
+{
+    ULONG lo = 0, hi = cmap->num, mid;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (cmap->entries[mid].code < code)
+            lo = mid + 1;
+        else if (cmap->entries[mid].code > code)
+            hi = mid;
+        else
+            return cmap->entries[mid].gid;
+    }
+    return 0;
+}
+
+void tt_release_cmap(struct tt_cmap *cmap)
+{
+    if (cmap) {
+        if (cmap->entries)
+            RELEASE(cmap->entries);
+        RELEASE(cmap);
+    }
+}
+
+@ name table
+@c
 USHORT
 tt_get_name(sfnt * sfont, char *dest, USHORT destlen,
             USHORT plat_id, USHORT enco_id, USHORT lang_id, USHORT name_id)
@@ -284,8 +284,10 @@ static void mark_reenc_glyphs(fo_entry * fo, internal_font_number f)
         assert(is_included(fo->fm));
         /* mark glyphs from TeX (externally reencoded characters) */
         g = fo->fe->glyph_names;
-        for (i = fo->first_char; i <= fo->last_char; i++) {
-            if (pdf_char_marked(f, i) && g[i] != notdef
+        for_each_used_char(f, i) {
+            if (i < fo->first_char || i > fo->last_char)
+                continue;
+            if (g[i] != notdef
                 && (char *) avl_find(fo->fd->gl_tree, g[i]) == NULL) {
                 aa = avl_probe(fo->fd->gl_tree, xstrdup(g[i]));
                 assert(aa != NULL);
@@ -309,8 +311,10 @@ static struct avl_table *mark_chars(fo_entry * fo, struct avl_table *tx_tree,
         tx_tree = avl_create(comp_int_entry, NULL, &avl_xallocator);
         assert(tx_tree != NULL);
     }
-    for (i = fo->first_char; i <= fo->last_char; i++) {
-        if (pdf_char_marked(f, i) && (int *) avl_find(tx_tree, &i) == NULL) {
+    for_each_used_char(f, i) {
+        if (i < fo->first_char || i > fo->last_char)
+            continue;
+        if ((int *) avl_find(tx_tree, &i) == NULL) {
             j = xtalloc(1, int);
             *j = i;
             aa = avl_probe(tx_tree, j);
@@ -326,35 +330,25 @@ static void get_char_range(fo_entry * fo, internal_font_number f)
 {
     int i;
     assert(fo != NULL);
-    for (i = font_bc(f); i <= font_ec(f); i++)  /* search for |first_char| and |last_char| */
-        if (pdf_char_marked(f, i))
-            break;
-    fo->first_char = i;
-    for (i = font_ec(f); i >= font_bc(f); i--)
-        if (pdf_char_marked(f, i))
-            break;
-    fo->last_char = i;
-    if ((fo->first_char > fo->last_char)
-        || !pdf_char_marked(f, fo->first_char)) {       /* no character used from this font */
-        fo->last_char = 0;
-        fo->first_char = fo->last_char + 1;
+    fo->last_char = 0;
+    fo->first_char = fo->last_char + 1;         /* no character used from this font */
+    for_each_used_char(f, i) {  /* search for |first_char| and |last_char| */
+        if (i < font_bc(f) || i > font_ec(f))
+            continue;
+        if (fo->first_char > fo->last_char)
+            fo->first_char = i;
+        fo->last_char = i;
     }
 }
 
 static int font_has_subset(internal_font_number f)
 {
-    int i, s;
-    for (i = font_bc(f); i <= font_ec(f); i++)  /* search for |first_char| and |last_char| */
-        if (pdf_char_marked(f, i))
-            break;
-    s = i;
-    for (i = font_ec(f); i >= font_bc(f); i--)
-        if (pdf_char_marked(f, i))
-            break;
-    if (s > i)
-        return 0;
-    else
-        return 1;
+    int i;
+    for_each_used_char(f, i) {
+        if (i >= font_bc(f) && i <= font_ec(f))
+            return 1;
+    }
+    return 0;
 }
 
 @
@@ -823,8 +817,10 @@ void do_pdf_font(PDF pdf, internal_font_number f)
         set_cidkeyed(fm);
         create_cid_fontdictionary(pdf, f);
 
-        if (del_file)
+        if (del_file) {
+            ttf_forget_font_file();
             unlink(fm->ff_name);
+        }
 
     } else {
         /* by now |font_map(f)|, if any, should have been set via |pdf_init_font()| */
@@ -884,8 +880,8 @@ static void mark_cid_subset_glyphs(fo_entry * fo, internal_font_number f)
     for (k = 1; k <= max_font_id(); k++) {
         if (k == f || -f == pdf_font_num(k)) {
             l = font_size(k);
-            for (i = font_bc(k); i <= font_ec(k); i++) {
-                if (quick_char_exists(k, i) && char_used(k, i)) {
+            for_each_used_char(k, i) {
+                if (i <= font_ec(k) && quick_char_exists(k, i)) {
                     j = xtalloc(1, glw_entry);
                     j->id = (unsigned) char_index(k, i);
                     j->wd = divide_scaled_n(char_width(k, i), l, 10000.0);
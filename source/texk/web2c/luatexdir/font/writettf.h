@@ -170,6 +170,9 @@ extern FILE *ttf_file;
 #  define ttf_getchar()    ttf_buffer[ttf_curbyte++]
 #  define ttf_eof()        (ttf_curbyte>ttf_size)
 
+extern boolean ttf_read_font_file(void);
+extern void ttf_free_buffer(void);
+
 extern long ttf_putnum(PDF pdf, int s, long n);
 extern long ttf_getnum(int s);
 #endif
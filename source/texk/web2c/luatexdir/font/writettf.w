@@ -36,6 +36,57 @@ unsigned char *ttf_buffer = NULL;
 int ttf_size = 0;
 int ttf_curbyte = 0;
 
+@ Documents often embed several fonts from one font file, for instance
+different sizes or feature sets of the same OpenType font. Unless a reader
+callback supplies the data, the contents of the last font file read are
+kept after embedding, so that the next font taken from it does not read the
+file again.
+
+@c
+static char *ttf_last_file_name = NULL;
+static unsigned char *ttf_last_buffer = NULL;
+static int ttf_last_size = 0;
+
+boolean ttf_read_font_file(void)
+{
+    if (ttf_last_file_name != NULL
+        && strcmp(ttf_last_file_name, cur_file_name) == 0) {
+        ttf_buffer = ttf_last_buffer;
+        ttf_size = ttf_last_size;
+        return true;
+    }
+    if (!ttf_open(cur_file_name))
+        return false;
+    ttf_read_file();
+    ttf_close();
+    xfree(ttf_last_file_name);
+    xfree(ttf_last_buffer);
+    ttf_last_file_name = xstrdup(cur_file_name);
+    ttf_last_buffer = ttf_buffer;
+    ttf_last_size = ttf_size;
+    return true;
+}
+
+@ Free |ttf_buffer| after embedding, unless it is the kept file contents.
+@c
+void ttf_free_buffer(void)
+{
+    if (ttf_buffer != ttf_last_buffer)
+        xfree(ttf_buffer);
+    ttf_buffer = NULL;
+}
+
+@ Temporary files (fonts extracted from a .dfont) are deleted after use and
+their names can come back, so their contents must not be kept.
+@c
+void ttf_forget_font_file(void)
+{
+    xfree(ttf_last_file_name);
+    xfree(ttf_last_buffer);
+    ttf_last_size = 0;
+}
+
+@ @c
 typedef struct {
     char *name;                 /* name of glyph */
     long code;                  /* charcode in case of subfonts */
@@ -431,6 +482,7 @@ void ttf_free(void)
 {
     if (ttf_cmap_tree != NULL)
         avl_destroy(ttf_cmap_tree, destroy_ttf_cmap_entry);
+    ttf_forget_font_file();
 }
 
 static int comp_ttf_cmap_entry(const void *pa, const void *pb, void *p)
@@ -1711,11 +1763,9 @@ void writettf(PDF pdf, fd_entry * fd)
             luatex_fail("cannot open TrueType font file for reading (%s)", cur_file_name);
         }
     } else {
-        if (!ttf_open(cur_file_name)) {
+        if (!ttf_read_font_file()) {
             luatex_fail("cannot open TrueType font file for reading (%s)", cur_file_name);
         }
-        ttf_read_file();
-        ttf_close();
     }
     if (tracefilenames) {
         if (is_subsetted(fd_cur->fm))
@@ -1756,7 +1806,7 @@ void writettf(PDF pdf, fd_entry * fd)
         else
             tex_printf(">>");
     }
-    xfree(ttf_buffer);
+    ttf_free_buffer();
     cur_file_name = NULL;
 }
 
@@ -1816,16 +1866,14 @@ void writeotf(PDF pdf, fd_entry * fd)
             luatex_fail("cannot open OpenType font file for reading (%s)", cur_file_name);
         }
     } else {
-        if (!otf_open(cur_file_name)) {
+        if (!ttf_read_font_file()) {
             luatex_fail("cannot open OpenType font file for reading (%s)", cur_file_name);
         }
-        ttf_read_file();
-        ttf_close();
     }
 
     fd_cur->ff_found = true;
     do_writeotf(pdf, fd);
-    xfree(ttf_buffer);
+    ttf_free_buffer();
     cur_file_name = NULL;
 }
 
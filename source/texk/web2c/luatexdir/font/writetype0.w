@@ -59,12 +59,10 @@ void writetype0(PDF pdf, fd_entry * fd)
                         cur_file_name);
         }
     } else {
-        if (!otf_open(cur_file_name)) {
+        if (!ttf_read_font_file()) {
             luatex_fail("cannot open OpenType font file for reading (%s)",
                         cur_file_name);
         }
-        ttf_read_file();
-        ttf_close();
     }
 
     fd_cur->ff_found = true;
@@ -112,7 +110,7 @@ void writetype0(PDF pdf, fd_entry * fd)
         }
     }
     xfree(dir_tab);
-    xfree(ttf_buffer);
+    ttf_free_buffer();
     if (is_subsetted(fd_cur->fm)) {
         report_stop_file(filetype_subset);
     } else {
@@ -162,11 +162,9 @@ void writetype2(PDF pdf, fd_entry * fd)
             luatex_fail("cannot open OpenType font file for reading (%s)", cur_file_name);
         }
     } else {
-        if (!otf_open(cur_file_name)) {
+        if (!ttf_read_font_file()) {
             luatex_fail("cannot open OpenType font file for reading (%s)", cur_file_name);
         }
-        ttf_read_file();
-        ttf_close();
     }
 
     fd_cur->ff_found = true;
@@ -182,7 +180,7 @@ void writetype2(PDF pdf, fd_entry * fd)
 #if 0
     xfree (dir_tab);
 #endif
-    xfree(ttf_buffer);
+    ttf_free_buffer();
     if (is_subsetted(fd_cur->fm)) 
         report_stop_file(filetype_subset);
      else 
@@ -20,6 +20,8 @@
 
 #include "ptexlib.h"
 #include "lua/luatex-api.h"
+#include "font/sfnt.h"
+#include "font/tt_table.h"
 
 #define TIMERS 0
 
@@ -169,7 +171,10 @@ static int setfont(lua_State * L)
     if (i) {
         luaL_checktype(L, -1, LUA_TTABLE);
         if (is_valid_font(i)) {
-            if (!(font_touched(i) || font_used(i))) {
+            if (font_shared(i) || font_instances(i) > 0) {
+                luaL_error(L,
+                           "that font shares its characters, changing it is forbidden");
+            } else if (!(font_touched(i) || font_used(i))) {
                 font_from_lua(L, i);
             } else {
                 luaL_error(L,
@@ -217,6 +222,70 @@ static int deffont(lua_State * L)
     return 0;                   /* not reached */
 }
 
+/* |font.instance(id, size)| defines font |id| again at another size. The new
+   font shares the characters of |id| and only has parameters of its own. */
+
+static int instancefont(lua_State * L)
+{
+    int i = (int) luaL_checkinteger(L, 1);
+    int s = (int) luaL_checkinteger(L, 2);
+    int k;
+    if (!is_valid_font(i) || i == 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, "that integer id is not a valid font");
+        return 2;
+    }
+    k = scale_font(i, s);
+    if (k == 0) {
+        lua_pushnil(L);
+        lua_pushstring(L, "math, virtual and unsized fonts can't be shared");
+        return 2;
+    }
+    lua_pushnumber(L, k);
+    return 1;
+}
+
+/* A font defined with |font.define| can be written to a cache file with
+   |font.save_cached|, and |font.load_cached| defines it again in a later run
+   straight from that file, without a Lua table in between. */
+
+static int savecachedfont(lua_State * L)
+{
+    int i = (int) luaL_checkinteger(L, 1);
+    const char *filename = luaL_checkstring(L, 2);
+    const char *msg;
+    if (!is_valid_font(i)) {
+        lua_pushnil(L);
+        lua_pushstring(L, "that integer id is not a valid font");
+        return 2;
+    }
+    msg = save_font_cache(i, filename);
+    if (msg != NULL) {
+        lua_pushnil(L);
+        lua_pushstring(L, msg);
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static int loadcachedfont(lua_State * L)
+{
+    const char *filename = luaL_checkstring(L, 1);
+    int i;
+    if (font_tables == NULL || font_tables[0] == NULL) {
+        create_null_font();
+    }
+    i = load_font_cache(filename);
+    if (i == 0) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "'%s' is not a usable font cache file", filename);
+        return 2;
+    }
+    lua_pushnumber(L, i);
+    return 1;
+}
+
 /* this returns the expected (!) next fontid. */
 static int nextfontid(lua_State * L)
 {
@@ -262,15 +331,656 @@ static int getfontid(lua_State * L)
 }
 
 
+/**********************************************************************/
+/* sfnt fonts: typesetting data read straight from OpenType files */
+
+/* |font.read_sfnt| opens an OpenType or TrueType font (or one font from a
+   collection) without going through the FontForge loader, which builds
+   every glyph outline even when only metrics are needed. The file is read
+   into memory and only its table directory is parsed. The header tables,
+   the advance widths, the cmap and the MATH constants are decoded into
+   compact C structures the first time they are asked for. Of GSUB, GPOS
+   and GDEF only the feature tags and the glyph classes can be asked for;
+   they are read in place by the same code that does the shaping. Their
+   lookups, and the rest of MATH, are only available as raw strings. */
+
+#define SFNT_METATABLE "luatex.sfnt"
+
+typedef struct {
+    unsigned char *buffer;
+    int buflen;
+    int subfonts;               /* number of fonts in the file */
+    sfnt *sfont;
+    USHORT numglyphs;
+    struct tt_head_table *head;
+    struct tt_hhea_table *hhea;
+    struct tt_os2__table *os2;
+    struct tt_longMetrics *hmtx;
+    struct tt_cmap *cmap;
+    int *math;                  /* the MATH constants */
+    boolean os2_done;           /* |os2| was looked for */
+    boolean math_done;          /* |math| was looked for */
+} sfnt_font;
+
+static ULONG sfnt_ulong_at(sfnt_font * f, ULONG p)
+{
+    unsigned char *b = f->buffer + p;
+    return ((ULONG) b[0] << 24) | ((ULONG) b[1] << 16) | ((ULONG) b[2] << 8) | b[3];
+}
+
+/* Tables are only looked at when they lie completely within the file, so
+   that a damaged font cannot make us read beyond the buffer. */
+
+static ULONG sfnt_table_len(sfnt_font * f, const char *tag)
+{
+    ULONG pos = sfnt_find_table_pos(f->sfont, tag);
+    ULONG len = sfnt_find_table_len(f->sfont, tag);
+    if (pos == 0 || pos > (ULONG) f->buflen || len > (ULONG) f->buflen - pos)
+        return 0;
+    return len;
+}
+
+static const char *sfnt_open_font(sfnt_font * f, int subfont)
+{
+    ULONG offset = 0;
+    ULONG magic;
+    USHORT num_tables;
+    if (f->buflen < 12)
+        return "file too short";
+    magic = sfnt_ulong_at(f, 0);
+    if (magic != 0x00010000UL && magic != 0x74727565UL  /* |true| */
+        && magic != 0x4f54544fUL && magic != 0x74746366UL)      /* |OTTO|, |ttcf| */
+        return "not an sfnt font";
+    f->sfont = sfnt_open(f->buffer, f->buflen);
+    f->subfonts = 1;
+    if (f->sfont->type == SFNT_TYPE_TTC) {
+        f->subfonts = (int) sfnt_ulong_at(f, 8);
+        if (subfont < 1 || subfont > f->subfonts)
+            return "no such subfont";
+        if (12 + 4 * (ULONG) subfont > (ULONG) f->buflen)
+            return "broken collection header";
+        offset = sfnt_ulong_at(f, 12 + 4 * (ULONG) (subfont - 1));
+    } else if (subfont != 1) {
+        return "no such subfont";
+    }
+    if (offset > (ULONG) f->buflen - 12)
+        return "broken table directory";
+    num_tables = (USHORT) ((f->buffer[offset + 4] << 8) | f->buffer[offset + 5]);
+    if (16 * (ULONG) num_tables > (ULONG) f->buflen - 12 - offset)
+        return "broken table directory";
+    sfnt_read_table_directory(f->sfont, offset);
+    if (sfnt_table_len(f, "head") < TT_HEAD_TABLE_SIZE
+        || sfnt_table_len(f, "hhea") < TT_HHEA_TABLE_SIZE
+        || sfnt_table_len(f, "maxp") < 6)
+        return "missing head, hhea or maxp table";
+    f->head = tt_read_head_table(f->sfont);
+    f->hhea = tt_read_hhea_table(f->sfont);
+    sfnt_locate_table(f->sfont, "maxp");
+    (void) sfnt_get_ulong(f->sfont);
+    f->numglyphs = sfnt_get_ushort(f->sfont);
+    return NULL;
+}
+
+static void sfnt_close_font(sfnt_font * f)
+{
+    if (f->sfont != NULL) {
+        sfnt_close(f->sfont);
+        f->sfont = NULL;
+    }
+    xfree(f->head);
+    xfree(f->hhea);
+    xfree(f->os2);
+    xfree(f->hmtx);
+    xfree(f->math);
+    if (f->cmap != NULL) {
+        tt_release_cmap(f->cmap);
+        f->cmap = NULL;
+    }
+    xfree(f->buffer);
+}
+
+static sfnt_font *check_sfnt(lua_State * L)
+{
+    sfnt_font *f = (sfnt_font *) luaL_checkudata(L, 1, SFNT_METATABLE);
+    if (f->sfont == NULL)
+        luaL_error(L, "the sfnt font is closed");
+    return f;
+}
+
+/* Version~0 of the OS/2 table is 78 bytes long, version~1 adds the code
+   page ranges (86 bytes) and version~2 and up add |sxHeight| and the
+   fields after it (96 bytes). */
+
+static struct tt_os2__table *sfnt_os2(sfnt_font * f)
+{
+    if (!f->os2_done) {
+        ULONG len = sfnt_table_len(f, "OS/2");
+        f->os2_done = true;
+        if (len >= 78) {
+            USHORT version;
+            sfnt_locate_table(f->sfont, "OS/2");
+            version = sfnt_get_ushort(f->sfont);
+            if (len >= (version == 0 ? 78 : version == 1 ? 86 : 96))
+                f->os2 = tt_read_os2__table(f->sfont);
+        }
+    }
+    return f->os2;
+}
+
+static struct tt_longMetrics *sfnt_hmtx(sfnt_font * f)
+{
+    if (f->hmtx == NULL) {
+        USHORT n = f->hhea->numberOfHMetrics;
+        if (n > f->numglyphs)
+            n = f->numglyphs;
+        if (n == 0 || sfnt_table_len(f, "hmtx") < 2 * ((ULONG) n + f->numglyphs))
+            return NULL;
+        sfnt_locate_table(f->sfont, "hmtx");
+        f->hmtx = tt_read_longMetrics(f->sfont, f->numglyphs, n);
+    }
+    return f->hmtx;
+}
+
+static struct tt_cmap *sfnt_cmap(sfnt_font * f)
+{
+    if (f->cmap == NULL) {
+        if (sfnt_table_len(f, "cmap") > 0)
+            f->cmap = tt_read_cmap_table(f->sfont);
+        else
+            f->cmap = xcalloc(1, sizeof(struct tt_cmap));
+    }
+    return f->cmap;
+}
+
+/* |tt_get_name| reads the string of the first matching record wherever
+   it points, so that record is checked against the table first. The
+   records themselves are known to be in the table. */
+
+static int sfnt_name_fits(sfnt_font * f, ULONG tlen, USHORT plat_id,
+                          USHORT enco_id, USHORT lang_id, USHORT name_id)
+{
+    USHORT num_names, string_offset, i;
+    sfnt_locate_table(f->sfont, "name");
+    (void) sfnt_get_ushort(f->sfont);
+    num_names = sfnt_get_ushort(f->sfont);
+    string_offset = sfnt_get_ushort(f->sfont);
+    for (i = 0; i < num_names; i++) {
+        USHORT p_id = sfnt_get_ushort(f->sfont);
+        USHORT e_id = sfnt_get_ushort(f->sfont);
+        USHORT l_id = sfnt_get_ushort(f->sfont);
+        USHORT n_id = sfnt_get_ushort(f->sfont);
+        USHORT length = sfnt_get_ushort(f->sfont);
+        USHORT offset = sfnt_get_ushort(f->sfont);
+        if (p_id == plat_id && e_id == enco_id && l_id == lang_id && n_id == name_id)
+            return ((ULONG) string_offset + offset + length <= tlen);
+    }
+    return 0;
+}
+
+/* Names are taken from the Windows Unicode records (converted to UTF-8)
+   and otherwise from the Macintosh Roman ones. A record whose string is
+   not in the table is skipped. */
+
+static void sfnt_push_name(lua_State * L, sfnt_font * f, USHORT name_id)
+{
+    char name[512];
+    USHORT len = 0;
+    ULONG tlen = sfnt_table_len(f, "name");
+    if (tlen < 6)
+        goto NONAME;
+    sfnt_locate_table(f->sfont, "name");
+    if (sfnt_get_ushort(f->sfont) != 0
+        || 6 + 12 * (ULONG) sfnt_get_ushort(f->sfont) > tlen)
+        goto NONAME;
+    if (sfnt_name_fits(f, tlen, 3, 1, 0x409u, name_id))
+        len = tt_get_name(f->sfont, name, sizeof(name), 3, 1, 0x409u, name_id);
+    if (len > 1) {
+        luaL_Buffer b;
+        USHORT i;
+        unsigned c, d;
+        luaL_buffinit(L, &b);
+        for (i = 0; i + 1 < len; i += 2) {
+            c = ((unsigned char) name[i] << 8) | (unsigned char) name[i + 1];
+            if (c >= 0xD800 && c < 0xDC00 && i + 3 < len) {
+                d = ((unsigned char) name[i + 2] << 8) | (unsigned char) name[i + 3];
+                if (d >= 0xDC00 && d < 0xE000) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (d - 0xDC00);
+                    i += 2;
+                }
+            }
+            if (c < 0x80) {
+                luaL_addchar(&b, (char) c);
+            } else if (c < 0x800) {
+                luaL_addchar(&b, (char) (0xC0 | (c >> 6)));
+                luaL_addchar(&b, (char) (0x80 | (c & 0x3F)));
+            } else if (c < 0x10000) {
+                luaL_addchar(&b, (char) (0xE0 | (c >> 12)));
+                luaL_addchar(&b, (char) (0x80 | ((c >> 6) & 0x3F)));
+                luaL_addchar(&b, (char) (0x80 | (c & 0x3F)));
+            } else {
+                luaL_addchar(&b, (char) (0xF0 | (c >> 18)));
+                luaL_addchar(&b, (char) (0x80 | ((c >> 12) & 0x3F)));
+                luaL_addchar(&b, (char) (0x80 | ((c >> 6) & 0x3F)));
+                luaL_addchar(&b, (char) (0x80 | (c & 0x3F)));
+            }
+        }
+        luaL_pushresult(&b);
+        return;
+    }
+    if (sfnt_name_fits(f, tlen, 1, 0, 0, name_id))
+        len = tt_get_name(f->sfont, name, sizeof(name), 1, 0, 0, name_id);
+    else
+        len = 0;
+    if (len > 0) {
+        lua_pushlstring(L, name, len);
+        return;
+    }
+  NONAME:
+    lua_pushnil(L);
+}
+
+#define sfnt_set_number(L,k,v) do {             \
+    lua_pushnumber(L, (lua_Number) (v));        \
+    lua_setfield(L, -2, k);                     \
+  } while (0)
+
+static int sfnt_info(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    struct tt_os2__table *os2 = sfnt_os2(f);
+    struct sfnt_table_directory *td = f->sfont->directory;
+    int i;
+    lua_createtable(L, 0, 20);
+    lua_pushstring(L, (sfnt_table_len(f, "CFF ") > 0 ? "opentype" : "truetype"));
+    lua_setfield(L, -2, "format");
+    sfnt_push_name(L, f, 6);
+    lua_setfield(L, -2, "fontname");
+    sfnt_push_name(L, f, 4);
+    lua_setfield(L, -2, "fullname");
+    sfnt_push_name(L, f, 1);
+    lua_setfield(L, -2, "familyname");
+    sfnt_set_number(L, "subfonts", f->subfonts);
+    sfnt_set_number(L, "units_per_em", f->head->unitsPerEm);
+    sfnt_set_number(L, "glyphs", f->numglyphs);
+    sfnt_set_number(L, "ascender", f->hhea->Ascender);
+    sfnt_set_number(L, "descender", f->hhea->Descender);
+    sfnt_set_number(L, "linegap", f->hhea->LineGap);
+    lua_createtable(L, 4, 0);
+    lua_pushnumber(L, f->head->xMin);
+    lua_rawseti(L, -2, 1);
+    lua_pushnumber(L, f->head->yMin);
+    lua_rawseti(L, -2, 2);
+    lua_pushnumber(L, f->head->xMax);
+    lua_rawseti(L, -2, 3);
+    lua_pushnumber(L, f->head->yMax);
+    lua_rawseti(L, -2, 4);
+    lua_setfield(L, -2, "boundingbox");
+    if (os2 != NULL) {
+        sfnt_set_number(L, "weight", os2->usWeightClass);
+        sfnt_set_number(L, "width", os2->usWidthClass);
+        if (os2->version >= 2) {
+            sfnt_set_number(L, "xheight", os2->sxHeight);
+            sfnt_set_number(L, "capheight", os2->sCapHeight);
+        }
+    }
+    lua_createtable(L, td->num_tables, 0);
+    for (i = 0; i < td->num_tables; i++) {
+        lua_pushlstring(L, td->tables[i].tag, 4);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "tables");
+    return 1;
+}
+
+static int sfnt_glyph(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    lua_Number c = luaL_checknumber(L, 2);
+    USHORT gid = 0;
+    if (c >= 0 && c <= 0x10FFFF)
+        gid = tt_cmap_lookup(sfnt_cmap(f), (ULONG) c);
+    if (gid == 0)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, gid);
+    return 1;
+}
+
+static int sfnt_unicodes(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    struct tt_cmap *cmap = sfnt_cmap(f);
+    ULONG i;
+    lua_createtable(L, 0, (int) cmap->num);
+    for (i = 0; i < cmap->num; i++) {
+        lua_pushnumber(L, cmap->entries[i].gid);
+        lua_rawseti(L, -2, (int) cmap->entries[i].code);
+    }
+    return 1;
+}
+
+static int sfnt_advance(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    lua_Number g = luaL_checknumber(L, 2);
+    struct tt_longMetrics *hmtx = sfnt_hmtx(f);
+    if (hmtx == NULL || g < 0 || g >= f->numglyphs)
+        lua_pushnil(L);
+    else
+        lua_pushnumber(L, hmtx[(int) g].advance);
+    return 1;
+}
+
+static int sfnt_table(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    size_t l;
+    const char *s = luaL_checklstring(L, 2, &l);
+    char tag[5] = "    ";
+    ULONG len;
+    memcpy(tag, s, (l > 4 ? 4 : l));
+    len = sfnt_table_len(f, tag);
+    if (len == 0)
+        lua_pushnil(L);
+    else
+        lua_pushlstring(L, (char *) f->buffer + sfnt_find_table_pos(f->sfont, tag), len);
+    return 1;
+}
+
+static void sfnt_ot_table(sfnt_font * f, const char *tag, ot_table * t)
+{
+    t->len = (unsigned) sfnt_table_len(f, tag);
+    t->data = (t->len > 0 ? f->buffer + sfnt_find_table_pos(f->sfont, tag) : NULL);
+}
+
+/* |features(tag)| gives the scripts, languages and features of the GSUB
+   or GPOS table, as |t[script][language] = { feature, ... }|. */
+
+static int sfnt_features(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    const char *tag = luaL_checkstring(L, 2);
+    ot_table t;
+    ot_feature_tag *list;
+    int i, n;
+    if (strcmp(tag, "GSUB") != 0 && strcmp(tag, "GPOS") != 0)
+        luaL_error(L, "features are only found in GSUB and GPOS");
+    sfnt_ot_table(f, tag, &t);
+    n = ot_feature_list(&t, &list);
+    if (n == 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_newtable(L);
+    for (i = 0; i < n; i++) {
+        lua_pushlstring(L, list[i].script, 4);
+        lua_rawget(L, -2);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushlstring(L, list[i].script, 4);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, -4);
+        }
+        lua_pushlstring(L, list[i].language, 4);
+        lua_rawget(L, -2);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushlstring(L, list[i].language, 4);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, -4);
+        }
+        lua_pushlstring(L, list[i].feature, 4);
+        lua_rawseti(L, -2, (int) lua_rawlen(L, -2) + 1);
+        lua_pop(L, 2);
+    }
+    xfree(list);
+    return 1;
+}
+
+static const char *sfnt_glyph_classes[] = {
+    NULL, "base", "ligature", "mark", "component"
+};
+
+static int sfnt_glyphclass(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    lua_Number g = luaL_checknumber(L, 2);
+    ot_table t;
+    int c = 0;
+    sfnt_ot_table(f, "GDEF", &t);
+    if (g >= 0 && g < f->numglyphs)
+        c = ot_gdef_glyph_class(&t, (int) g);
+    if (c < 1 || c > 4)
+        lua_pushnil(L);
+    else
+        lua_pushstring(L, sfnt_glyph_classes[c]);
+    return 1;
+}
+
+/* The MathConstants subtable of MATH: two percentages, two heights, 51
+   value records (of which the device table is skipped) and one more
+   percentage, in this order. */
+
+static const char *sfnt_math_names[] = {
+    "ScriptPercentScaleDown", "ScriptScriptPercentScaleDown",
+    "DelimitedSubFormulaMinHeight", "DisplayOperatorMinHeight",
+    "MathLeading", "AxisHeight", "AccentBaseHeight",
+    "FlattenedAccentBaseHeight", "SubscriptShiftDown", "SubscriptTopMax",
+    "SubscriptBaselineDropMin", "SuperscriptShiftUp",
+    "SuperscriptShiftUpCramped", "SuperscriptBottomMin",
+    "SuperscriptBaselineDropMax", "SubSuperscriptGapMin",
+    "SuperscriptBottomMaxWithSubscript", "SpaceAfterScript",
+    "UpperLimitGapMin", "UpperLimitBaselineRiseMin", "LowerLimitGapMin",
+    "LowerLimitBaselineDropMin", "StackTopShiftUp",
+    "StackTopDisplayStyleShiftUp", "StackBottomShiftDown",
+    "StackBottomDisplayStyleShiftDown", "StackGapMin",
+    "StackDisplayStyleGapMin", "StretchStackTopShiftUp",
+    "StretchStackBottomShiftDown", "StretchStackGapAboveMin",
+    "StretchStackGapBelowMin", "FractionNumeratorShiftUp",
+    "FractionNumeratorDisplayStyleShiftUp", "FractionDenominatorShiftDown",
+    "FractionDenominatorDisplayStyleShiftDown", "FractionNumeratorGapMin",
+    "FractionNumeratorDisplayStyleGapMin", "FractionRuleThickness",
+    "FractionDenominatorGapMin", "FractionDenominatorDisplayStyleGapMin",
+    "SkewedFractionHorizontalGap", "SkewedFractionVerticalGap",
+    "OverbarVerticalGap", "OverbarRuleThickness", "OverbarExtraAscender",
+    "UnderbarVerticalGap", "UnderbarRuleThickness", "UnderbarExtraDescender",
+    "RadicalVerticalGap", "RadicalDisplayStyleVerticalGap",
+    "RadicalRuleThickness", "RadicalExtraAscender",
+    "RadicalKernBeforeDegree", "RadicalKernAfterDegree",
+    "RadicalDegreeBottomRaisePercent", NULL
+};
+
+#define sfnt_math_count 56
+#define sfnt_math_size (8 + 51 * 4 + 2)       /* bytes in MathConstants */
+
+static int *sfnt_math(sfnt_font * f)
+{
+    if (!f->math_done) {
+        ULONG len = sfnt_table_len(f, "MATH");
+        f->math_done = true;
+        if (len >= 10) {
+            unsigned char *b = f->buffer + sfnt_find_table_pos(f->sfont, "MATH");
+            ULONG p = (ULONG) ((b[4] << 8) | b[5]);
+            if (p > 0 && p <= len && len - p >= sfnt_math_size) {
+                int i;
+                f->math = xmalloc(sfnt_math_count * sizeof(int));
+                for (i = 0; i < sfnt_math_count; i++) {
+                    f->math[i] = (short) ((b[p] << 8) | b[p + 1]);
+                    if (i == 2 || i == 3)       /* unsigned heights */
+                        f->math[i] = (unsigned short) f->math[i];
+                    p += (i >= 4 && i < 55 ? 4 : 2);
+                }
+            }
+        }
+    }
+    return f->math;
+}
+
+static int sfnt_mathconstants(lua_State * L)
+{
+    sfnt_font *f = check_sfnt(L);
+    int *math = sfnt_math(f);
+    int i;
+    if (math == NULL) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_createtable(L, 0, sfnt_math_count);
+    for (i = 0; i < sfnt_math_count; i++)
+        sfnt_set_number(L, sfnt_math_names[i], math[i]);
+    return 1;
+}
+
+static int sfnt_gc(lua_State * L)
+{
+    sfnt_font *f = (sfnt_font *) luaL_checkudata(L, 1, SFNT_METATABLE);
+    sfnt_close_font(f);
+    return 0;
+}
+
+static int sfnt_tostring(lua_State * L)
+{
+    sfnt_font *f = (sfnt_font *) luaL_checkudata(L, 1, SFNT_METATABLE);
+    lua_pushfstring(L, "<sfnt font %p>", f);
+    return 1;
+}
+
+static const struct luaL_Reg sfnt_m[] = {
+    {"info", sfnt_info},
+    {"glyph", sfnt_glyph},
+    {"unicodes", sfnt_unicodes},
+    {"advance", sfnt_advance},
+    {"table", sfnt_table},
+    {"features", sfnt_features},
+    {"glyphclass", sfnt_glyphclass},
+    {"mathconstants", sfnt_mathconstants},
+    {"close", sfnt_gc},
+    {NULL, NULL}                /* sentinel */
+};
+
+static int font_read_sfnt(lua_State * L)
+{
+    const char *filename = luaL_checkstring(L, 1);
+    int subfont = (int) luaL_optinteger(L, 2, 1);
+    const char *msg;
+    sfnt_font *f;
+    FILE *fp;
+    f = (sfnt_font *) lua_newuserdata(L, sizeof(sfnt_font));
+    memset(f, 0, sizeof(sfnt_font));
+    luaL_getmetatable(L, SFNT_METATABLE);
+    lua_setmetatable(L, -2);
+    fp = fopen(filename, FOPEN_RBIN_MODE);
+    if (fp == NULL) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "font file '%s' not found", filename);
+        return 2;
+    }
+    recorder_record_input(filename);
+    if (!readbinfile(fp, &f->buffer, &f->buflen)) {
+        fclose(fp);
+        lua_pushnil(L);
+        lua_pushfstring(L, "font file '%s' can't be read", filename);
+        return 2;
+    }
+    fclose(fp);
+    msg = sfnt_open_font(f, subfont);
+    if (msg != NULL) {
+        sfnt_close_font(f);
+        lua_pushnil(L);
+        lua_pushfstring(L, "font file '%s': %s", filename, msg);
+        return 2;
+    }
+    return 1;
+}
+
+
+/* |font.setshaping(id, sfnt, spec)| gives a font the OpenType tables of an
+   sfnt font, and selects the lookups that |handle_shaping| applies to it.
+   The |spec| table has a |script|, a |language|, a list of |features| and
+   the number of the |alternate| to use; without it, the usual default
+   features for the default script are used. Without an sfnt font, the
+   shaping data is removed. The font's characters need an |index|, and
+   glyphs can only be substituted into glyphs that have a character. */
+
+static const char *default_features[] = {
+    "ccmp", "locl", "rlig", "liga", "clig", "calt", "kern", "mark", "mkmk"
+};
+
+static int setshaping(lua_State * L)
+{
+    int i = (int) luaL_checkinteger(L, 1);
+    sfnt_font *f;
+    ot_table gsub, gpos, gdef;
+    ot_shaper *sh;
+    const char *script = NULL, *language = NULL;
+    const char **features = default_features;
+    int num_features = (int) (sizeof(default_features) / sizeof(char *));
+    int alternate = 1;
+    if (!is_valid_font(i)) {
+        lua_pushnil(L);
+        lua_pushstring(L, "that integer id is not a valid font");
+        return 2;
+    }
+    if (lua_isnoneornil(L, 2)) {
+        set_font_shaper(i, NULL);
+        lua_pushnumber(L, 0);
+        return 1;
+    }
+    f = (sfnt_font *) luaL_checkudata(L, 2, SFNT_METATABLE);
+    if (f->sfont == NULL)
+        luaL_error(L, "the sfnt font is closed");
+    if (lua_istable(L, 3)) {
+        lua_getfield(L, 3, "script");
+        if (lua_isstring(L, -1))
+            script = lua_tostring(L, -1);
+        lua_getfield(L, 3, "language");
+        if (lua_isstring(L, -1))
+            language = lua_tostring(L, -1);
+        lua_getfield(L, 3, "alternate");
+        if (lua_isnumber(L, -1))
+            alternate = (int) lua_tointeger(L, -1);
+        lua_getfield(L, 3, "features");
+        if (lua_istable(L, -1)) {
+            int k, n = (int) lua_rawlen(L, -1);
+            features = xmalloc((unsigned) (n + 1) * sizeof(char *));
+            for (num_features = 0, k = 1; k <= n; k++) {
+                lua_rawgeti(L, -1, k);
+                if (lua_isstring(L, -1))
+                    features[num_features++] = lua_tostring(L, -1);
+                lua_pop(L, 1);  /* the strings stay alive in the table */
+            }
+        }
+    }
+    sfnt_ot_table(f, "GSUB", &gsub);
+    sfnt_ot_table(f, "GPOS", &gpos);
+    sfnt_ot_table(f, "GDEF", &gdef);
+    sh = new_ot_shaper(i, &gsub, &gpos, &gdef, (int) f->numglyphs,
+                       (font_units_per_em(i) > 0 ? font_units_per_em(i)
+                        : (int) f->head->unitsPerEm),
+                       script, language, features, num_features, alternate);
+    if (features != default_features)
+        xfree(features);
+    set_font_shaper(i, sh);
+    lua_pushnumber(L, ot_shaper_lookups(sh));
+    return 1;
+}
+
 static const struct luaL_Reg fontlib[] = {
     {"read_tfm", font_read_tfm},
     {"read_vf", font_read_vf},
+    {"read_sfnt", font_read_sfnt},
     {"current", tex_current_font},
     {"max", tex_max_font},
     {"each", tex_each_font},
     {"getfont", getfont},
     {"setfont", setfont},
     {"define", deffont},
+    {"instance", instancefont},
+    {"save_cached", savecachedfont},
+    {"load_cached", loadcachedfont},
+    {"setshaping", setshaping},
     {"nextid", nextfontid},
     {"id", getfontid},
     {"frozen", frozenfont},
@@ -279,6 +989,15 @@ static const struct luaL_Reg fontlib[] = {
 
 int luaopen_font(lua_State * L)
 {
+    luaL_newmetatable(L, SFNT_METATABLE);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+    luaL_register(L, NULL, sfnt_m);
+    lua_pushcfunction(L, sfnt_gc);
+    lua_setfield(L, -2, "__gc");
+    lua_pushcfunction(L, sfnt_tostring);
+    lua_setfield(L, -2, "__tostring");
+    lua_pop(L, 1);
     luaL_register(L, "font", fontlib);
     make_table(L, "fonts", "tex.fonts", "getfont", "setfont");
     return 1;
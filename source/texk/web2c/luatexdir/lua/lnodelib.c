@@ -1727,6 +1727,42 @@ static int lua_nodelib_direct_dimensions(lua_State * L)
     return 0;                   /* not reached */
 }
 
+/* node.direct.measure: the natural dimensions of a list and its glue totals
+   in one pass, returned as width, height, depth, stretch, stretch order,
+   shrink and shrink order, where the orders are the highest ones present
+   as |hpack| would use them */
+
+static int lua_nodelib_direct_measure(lua_State * L)
+{
+    scaled_whd siz;
+    scaled stretch_t[filll + 1];
+    scaled shrink_t[filll + 1];
+    int d = -1;
+    int o;
+    halfword n, p = null;
+    n = (halfword) luaL_checkinteger(L, 1);
+    if (lua_gettop(L) > 1 && !lua_isnil(L, 2)) {
+        if (lua_type(L, 2) == LUA_TSTRING) {
+            d = nodelib_getdir(L, 2, 1);
+        } else {
+            p = (halfword) lua_tonumber(L, 2);
+        }
+    }
+    if (lua_gettop(L) > 2 && lua_type(L, 3) == LUA_TSTRING)
+        d = nodelib_getdir(L, 3, 1);
+    siz = natural_totals(n, p, d, stretch_t, shrink_t);
+    lua_pushnumber(L, siz.wd);
+    lua_pushnumber(L, siz.ht);
+    lua_pushnumber(L, siz.dp);
+    for (o = filll; o > normal && stretch_t[o] == 0; o--);
+    lua_pushnumber(L, stretch_t[o]);
+    lua_pushnumber(L, o);
+    for (o = filll; o > normal && shrink_t[o] == 0; o--);
+    lua_pushnumber(L, shrink_t[o]);
+    lua_pushnumber(L, o);
+    return 7;
+}
+
 /* node.mlist_to_hlist (create a hlist from a formula) */
 
 static int lua_nodelib_mlist_to_hlist(lua_State * L)
@@ -4023,6 +4059,46 @@ static int font_tex_kerning(lua_State * L)
 }
 
 
+/* node.shaping */
+
+static int font_tex_shaping(lua_State * L)
+{
+    /* on the stack are two nodes */
+
+    halfword tmp_head;
+    halfword *h;
+    halfword t = null;
+    halfword p ;
+    if (lua_gettop(L) < 1) {
+        lua_pushnil(L);
+        lua_pushboolean(L, 0);
+        return 2;
+    }
+    h = check_isnode(L, 1);
+    if (lua_gettop(L) > 1) {
+        t = *(check_isnode(L, 2));
+    }
+    if (t == null)
+        t = tail_of_list(*h);
+    tmp_head = new_node(nesting_node, 1);
+    p = alink(*h);
+    couple_nodes(tmp_head, *h);
+    tlink(tmp_head) = t;
+    t = handle_shaping(tmp_head, t);
+    if (p != null) {
+        vlink(p) = vlink(tmp_head) ;
+    }
+    alink(vlink(tmp_head)) = p ;
+    lua_pushnumber(L, vlink(tmp_head));
+    flush_node(tmp_head);
+    lua_nodelib_push(L);
+    lua_pushnumber(L, t);
+    lua_nodelib_push(L);
+    lua_pushboolean(L, 1);
+    return 3;
+}
+
+
 /* node.protect_glyphs (returns also boolean because that signals callback) */
 
 static int lua_nodelib_protect_glyphs(lua_State * L)
@@ -6313,6 +6389,7 @@ static const struct luaL_Reg direct_nodelib_f[] = {
     {"length", lua_nodelib_direct_length},
  /* {"ligaturing", font_tex_ligaturing}, */                   /* maybe direct too (rather basic callback exposure) */
  /* {"mlist_to_hlist", lua_nodelib_mlist_to_hset_properties_modelist}, */        /* maybe direct too (rather basic callback exposure) */
+    {"measure", lua_nodelib_direct_measure},
     {"new", lua_nodelib_direct_new},
  /* {"next", lua_nodelib_next}, */                            /* replaced by getnext */
  /* {"prev", lua_nodelib_prev}, */                            /* replaced by getprev */
@@ -6400,6 +6477,7 @@ static const struct luaL_Reg nodelib_f[] = {
     {"remove", lua_nodelib_remove},
  /* {"setbox", lua_nodelib_setbox}, */ /* tex.setbox */
     {"set_attribute", lua_nodelib_set_attribute},
+    {"shaping", font_tex_shaping},
     {"slide", lua_nodelib_slide},
     {"subtype", lua_nodelib_subtype},
     {"tail", lua_nodelib_tail},
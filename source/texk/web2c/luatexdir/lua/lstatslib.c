@@ -157,13 +157,6 @@ static lua_Number get_obj_tab_size(void)
     return (lua_Number) 0;
 }
 
-static lua_Number get_dest_names_size(void)
-{
-    if (static_pdf != NULL)
-        return (lua_Number) static_pdf->dest_names_size;
-    return (lua_Number) 0;
-}
-
 static lua_Number get_dest_names_ptr(void)
 {
     if (static_pdf != NULL)
@@ -176,6 +169,16 @@ static int get_hash_size(void)
     return hash_size;           /* is a #define */
 }
 
+static lua_Number get_cs_lookups(void)
+{
+    return (lua_Number) cs_lookups;
+}
+
+static lua_Number get_cs_probes(void)
+{
+    return (lua_Number) cs_probes;
+}
+
 static int luastate_max = 1;    /* fixed value */
 
 /* temp, for backward compat */
@@ -235,6 +238,10 @@ static struct statistic stats[] = {
     {"cs_count", 'g', &cs_count},
     {"hash_size", 'G', &get_hash_size},
     {"hash_extra", 'g', &hash_extra},
+    {"cs_index_size", 'G', &get_cs_index_size},
+    {"cs_lookups", 'N', &get_cs_lookups},
+    {"cs_probes", 'N', &get_cs_probes},
+    {"cs_max_probes", 'g', &cs_max_probes},
     {"font_ptr", 'G', &max_font_id},
     {"max_in_stack", 'g', &max_in_stack},
     {"max_nest_stack", 'g', &max_nest_stack},
@@ -252,12 +259,16 @@ static struct statistic stats[] = {
     {"pdf_os_cntr", 'N', &get_pdf_os_cntr},
     {"pdf_os_objidx", 'N', &get_pdf_os_objidx},
     {"pdf_dest_names_ptr", 'N', &get_dest_names_ptr},
-    {"dest_names_size", 'N', &get_dest_names_size},
+    {"dest_names_size", 'N', &get_dest_names_ptr},      /* no separate table anymore */
     {"pdf_mem_ptr", 'N', &get_pdf_mem_ptr},
     {"pdf_mem_size", 'N', &get_pdf_mem_size},
 
     {"largest_used_mark", 'g', &biggest_used_mark},
 
+    {"math_cache_entries", 'g', &math_cache_entries},
+    {"math_cache_hits", 'g', &math_cache_hits},
+    {"math_cache_misses", 'g', &math_cache_misses},
+
     {"luabytecodes", 'g', &luabytecode_max},
     {"luabytecode_bytes", 'g', &luabytecode_bytes},
     {"luastates", 'g', &luastate_max},
@@ -2370,6 +2370,69 @@ static int tex_run_linebreak(lua_State * L)
     return 2;
 }
 
+static int tex_run_pagebreak(lua_State * L)
+{
+    halfword *j;
+    halfword topskip, *breaks = NULL;
+    scaled maxdepth, *heights;
+    int nheights, nbreaks, pages, pagepenalty, i;
+    double demerits;
+    j = check_isnode(L, 1);     /* the value */
+    if (lua_gettop(L) != 2 || lua_type(L, 2) != LUA_TTABLE) {
+        lua_checkstack(L, 3);
+        lua_newtable(L);
+    }
+    lua_pushstring(L, "height");
+    lua_gettable(L, -2);
+    if (lua_type(L, -1) == LUA_TTABLE) {
+        nheights = (int) lua_rawlen(L, -1);
+        if (nheights == 0) {
+            lua_pushnil(L);
+            lua_pushstring(L, "no page heights given");
+            return 2;
+        }
+        heights = xmalloc((unsigned) nheights * sizeof(scaled));
+        for (i = 1; i <= nheights; i++) {
+            lua_rawgeti(L, -1, i);
+            if (lua_type(L, -1) != LUA_TNUMBER) {
+                xfree(heights);
+                luaL_error(L, "page height %d is not a number", i);
+            }
+            heights[i - 1] = (scaled) lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+    } else {
+        nheights = 1;
+        heights = xmalloc(sizeof(scaled));
+        if (lua_type(L, -1) == LUA_TNUMBER)
+            heights[0] = (scaled) lua_tonumber(L, -1);
+        else
+            heights[0] = dimen_par(vsize_code);
+    }
+    lua_pop(L, 1);
+    get_glue_par("topskip", topskip, glue_par(top_skip_code));
+    get_dimen_par("maxdepth", maxdepth, dimen_par(max_depth_code));
+    get_int_par("pagepenalty", pagepenalty, int_par(line_penalty_code));
+    pages = page_breaks(*j, heights, nheights, topskip, maxdepth, pagepenalty,
+                        &breaks, &nbreaks, &demerits);
+    xfree(heights);
+    /* return the breakpoints, and some information about the result */
+    lua_createtable(L, nbreaks, 0);
+    for (i = 0; i < nbreaks; i++) {
+        lua_nodelib_push_fast(L, breaks[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    xfree(breaks);
+    lua_newtable(L);
+    lua_pushstring(L, "demerits");
+    lua_pushnumber(L, demerits);
+    lua_settable(L, -3);
+    lua_pushstring(L, "pages");
+    lua_pushnumber(L, pages);
+    lua_settable(L, -3);
+    return 2;
+}
+
 static int tex_shipout(lua_State * L)
 {
     int boxnum = get_box_id(L, 1);
@@ -2633,6 +2696,7 @@ static const struct luaL_Reg texlib[] = {
     {"setmath", tex_setmathparm},
     {"getmath", tex_getmathparm},
     {"linebreak", tex_run_linebreak},
+    {"pagebreak", tex_run_pagebreak},
     /* tex random generators     */
     {"init_rand",   tex_init_rand},
     {"uniform_rand",tex_unif_rand},
@@ -47,10 +47,7 @@ typedef enum {
 #  define set_pdf_dest_type(A,B) pdf_dest_type(A)=B
 #  define set_pdf_dest_xyz_zoom(A,B) pdf_dest_xyz_zoom(A)=B
 
-#  define inf_dest_names_size 1000      /* min size of the destination names table for PDF output */
-#  define sup_dest_names_size 131072    /* max size of the destination names table for PDF output */
-
-extern void append_dest_name(PDF, char *, int);
+extern void append_dest_name(PDF);
 extern void do_dest(PDF pdf, halfword p, halfword parent_box, scaledpos cur);
 extern void warn_dest_dup(int id, small_number byname, const char *s1,
                           const char *s2);
@@ -58,7 +55,6 @@ extern void warn_dest_dup(int id, small_number byname, const char *s1,
 extern void write_out_pdf_mark_destinations(PDF);
 extern void scan_pdfdest(PDF);
 extern void init_dest_names(PDF);
-extern void sort_dest_names(PDF);
 extern int output_name_tree(PDF);
 
 
@@ -32,29 +32,15 @@ forward.
 @c
 void init_dest_names(PDF pdf)
 {
-    pdf->dest_names_size = inf_dest_names_size;
-    pdf->dest_names = xmallocarray(dest_name_entry, inf_dest_names_size);       /* will grow dynamically */
+    pdf->dest_names_ptr = 0;
 }
 
-@ @c
-void append_dest_name(PDF pdf, char *s, int n)
+@ Named destinations are kept sorted by name in |pdf->obj_tree[obj_type_dest]|
+as they are created, so all we have to do here is count them.
+
+@c
+void append_dest_name(PDF pdf)
 {
-    int a;
-    if (pdf->dest_names_ptr == sup_dest_names_size)
-        overflow("number of destination names (dest_names_size)",
-                 (unsigned) pdf->dest_names_size);
-    if (pdf->dest_names_ptr == pdf->dest_names_size) {
-        a = pdf->dest_names_size / 5;
-        if (pdf->dest_names_size < sup_dest_names_size - a)
-            pdf->dest_names_size = pdf->dest_names_size + a;
-        else
-            pdf->dest_names_size = sup_dest_names_size;
-        pdf->dest_names =
-            xreallocarray(pdf->dest_names, dest_name_entry,
-                          (unsigned) pdf->dest_names_size);
-    }
-    pdf->dest_names[pdf->dest_names_ptr].objname = xstrdup(s);
-    pdf->dest_names[pdf->dest_names_ptr].objnum = n;
     pdf->dest_names_ptr++;
 }
 
@@ -288,23 +274,9 @@ void scan_pdfdest(PDF pdf)
     }
 }
 
-@ sorts |dest_names| by names
-@c
-static int dest_cmp(const void *a, const void *b)
-{
-    dest_name_entry aa = *(const dest_name_entry *) a;
-    dest_name_entry bb = *(const dest_name_entry *) b;
-    return strcmp(aa.objname, bb.objname);
-}
-
-@ @c
-void sort_dest_names(PDF pdf)
-{
-    qsort(pdf->dest_names, (size_t) pdf->dest_names_ptr,
-          sizeof(dest_name_entry), dest_cmp);
-}
-
-@ Output the name tree. The tree nature of the destination list forces the
+@ Output the name tree. The leaves are written while walking the AVL tree
+of named destinations in order, so there is no need to collect and sort the
+names first. The tree nature of the destination list forces the
 storing of intermediate data in |obj_info| and |obj_aux| fields, which
 is further uglified by the fact that |obj_tab| entries do not accept char
 pointers.
@@ -314,16 +286,22 @@ int output_name_tree(PDF pdf)
 {
     boolean is_names = true;    /* flag for name tree output: is it Names or Kids? */
     int b = 0, j, l;
-    int k = 0;                  /* index of current child of |l|; if |k < pdf_dest_names_ptr|
-                                   then this is pointer to |dest_names| array;
-                                   otherwise it is the pointer to |obj_tab| (object number) */
+    int k = 0;                  /* index of current child of |l| in |obj_tab| (object number) */
     int m;
     int dests = 0;
     int names_head = 0, names_tail = 0;
+    struct avl_traverser t;
+    oentry *p;                  /* current leaf in the destination tree */
+    char *last = NULL;          /* name of the last leaf written into a node */
     if (pdf->dest_names_ptr == 0) {
         goto DONE;
     }
-    sort_dest_names(pdf);
+    /* numbered destinations sort before the named ones */
+    avl_t_init(&t, pdf->obj_tree[obj_type_dest]);
+    p = (oentry *) avl_t_first(&t, pdf->obj_tree[obj_type_dest]);
+    while (p != NULL && p->u_type == union_type_int)
+        p = (oentry *) avl_t_next(&t);
+    assert(p != NULL);
 
     while (true) {
         do {
@@ -343,18 +321,19 @@ int output_name_tree(PDF pdf)
             pdf_begin_dict(pdf);
             j = 0;
             if (is_names) {
-                set_obj_start(pdf, l, pdf->dest_names[k].objname);
+                set_obj_start(pdf, l, p->u.str0);
                 pdf_add_name(pdf, "Names");
                 pdf_begin_array(pdf);
                 do {
-                    pdf_add_string(pdf, pdf->dest_names[k].objname);
-                    pdf_add_ref(pdf, pdf->dest_names[k].objnum);
+                    pdf_add_string(pdf, p->u.str0);
+                    pdf_add_ref(pdf, p->objptr);
+                    last = p->u.str0;
                     j++;
-                    k++;
-                } while (j != name_tree_kids_max && k != pdf->dest_names_ptr);
+                    p = (oentry *) avl_t_next(&t);
+                } while (j != name_tree_kids_max && p != NULL);
                 pdf_end_array(pdf);
-                set_obj_stop(pdf, l, pdf->dest_names[k - 1].objname);   /* for later */
-                if (k == pdf->dest_names_ptr) {
+                set_obj_stop(pdf, l, last);     /* for later */
+                if (p == NULL) {
                     is_names = false;
                     k = names_head;
                     b = 0;
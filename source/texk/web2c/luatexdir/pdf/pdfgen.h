@@ -44,10 +44,11 @@ written bytes.
 
 #  define inf_pdfout_buf_size 16384 /* initial value of |pdf->buf| size */
 #  define sup_pdfout_buf_size 16384     /* arbitrary upper hard limit of |pdf->buf| size */
-#  define inf_objstm_buf_size 1 /* initial value of |os->buf[OBJSTM_BUF]| size */
+#  define inf_objstm_buf_size PDF_OS_MAX_BYTES      /* initial value of |os->buf[OBJSTM_BUF]| size */
 #  define sup_objstm_buf_size 5000000   /* arbitrary upper hard limit of |os->buf[OBJSTM_BUF]| size */
 
 #  define PDF_OS_MAX_OBJS 100   /* maximum number of objects in object stream */
+#  define PDF_OS_MAX_BYTES 65536        /* close object stream once its contents grow beyond this size */
 
 #  define inf_obj_tab_size 1000 /* min size of the cross-reference table for PDF output */
 #  define sup_obj_tab_size 8388607      /* max size of the cross-reference table for PDF output */
@@ -1166,6 +1166,8 @@ and appended to the ready buffered object stream.
 By this the value of \.{/First} can be calculated.
 Then a new \.{/ObjStm} object is generated, and everything is
 copied to the PDF output buffer, where also compression is done.
+A stream is closed when it holds |PDF_OS_MAX_OBJS| objects or when
+its contents exceed |PDF_OS_MAX_BYTES|, whichever comes first.
 When calling this procedure, |pdf_os_mode| must be |true|.
 
 @c
@@ -1406,7 +1408,10 @@ void pdf_end_obj(PDF pdf)
     case OBJSTM_BUF:
         os->idx++;              /* = number of objects collected so far in ObjStm */
         os->o_ctr++;            /* only for statistics */
-        if (os->idx == PDF_OS_MAX_OBJS)
+        /* a few large objects (annotations, structure elements) fill a stream
+           as well as many small ones, so also close it on its byte size */
+        if (os->idx == PDF_OS_MAX_OBJS
+            || strbuf_offset(os->buf[OBJSTM_BUF]) >= PDF_OS_MAX_BYTES)
             pdf_os_write_objstream(pdf);
         else
             pdf_out(pdf, '\n'); /* Adobe Reader seems to need this */
@@ -2410,8 +2415,8 @@ void finish_pdf_file(PDF pdf, int luatexversion, str_number luatexrevision)
                 if (font_used(k) && (pdf_font_num(k) < 0)) {
                     i = -pdf_font_num(k);
                     assert(pdf_font_num(i) > 0);
-                    for (j = font_bc(k); j <= font_ec(k); j++)
-                        if (quick_char_exists(k, j) && pdf_char_marked(k, j))
+                    for_each_used_char(k, j)
+                        if (j <= font_ec(k) && quick_char_exists(k, j))
                             pdf_mark_char(i, j);
                     if ((pdf_font_attr(i) == 0) && (pdf_font_attr(k) != 0)) {
                         set_pdf_font_attr(i, pdf_font_attr(k));
@@ -2455,9 +2460,7 @@ void finish_pdf_file(PDF pdf, int luatexversion, str_number luatexrevision)
             /* The name tree is very similiar to Pages tree so its construction should be
                certain from Pages tree construction. For intermediate node |obj_info| will be
                the first name and |obj_link| will be the last name in \.{\\Limits} array.
-               Note that |pdf_dest_names_ptr| will be less than |obj_ptr|, so we test if
-               |k < pdf_dest_names_ptr| then |k| is index of leaf in |dest_names|; else
-               |k| will be index in |obj_tab| of some intermediate node.
+               The leaves are taken in order from the AVL tree of named destinations.
              */
             names_tree = output_name_tree(pdf);
 
@@ -2660,9 +2663,8 @@ void finish_pdf_file(PDF pdf, int luatexversion, str_number luatexrevision)
                         (int) pdf->os->o_ctr, (int) pdf->os->ostm_ctr,
                         (pdf->os->ostm_ctr > 1 ? "s" : ""));
             }
-            fprintf(log_file, " %d named destinations out of %d (max. %d)\n",
-                    (int) pdf->dest_names_ptr, (int) pdf->dest_names_size,
-                    (int) sup_dest_names_size);
+            fprintf(log_file, " %d named destinations\n",
+                    (int) pdf->dest_names_ptr);
             fprintf(log_file,
                     " %d words of extra memory for PDF output out of %d (max. %d)\n",
                     (int) pdf->mem_ptr, (int) pdf->mem_size,
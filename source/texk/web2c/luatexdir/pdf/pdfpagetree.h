@@ -23,6 +23,6 @@
 
 int output_pages_tree(PDF);
 int pdf_do_page_divert(PDF, int, int);
-void pdf_do_page_undivert(int, int);
+void pdf_do_page_undivert(PDF, int, int);
 
 #endif                          /* PAGETREE_H */
@@ -73,6 +73,98 @@ static pages_entry *new_pages_entry(PDF pdf)
     return p;
 }
 
+@ write a /Pages object
+@c
+#define pdf_pages_attr equiv(pdf_pages_attr_loc)
+
+static void write_pages(PDF pdf, pages_entry * p, int parent)
+{
+    int i;
+    assert(p != NULL);
+    pdf_begin_obj(pdf, p->objnum, OBJSTM_ALWAYS);
+    pdf_begin_dict(pdf);
+    pdf_dict_add_name(pdf, "Type", "Pages");
+    if (parent == 0) {          /* it's root */
+        if (pdf_pages_attr != null) {
+            pdf_print_toks(pdf, pdf_pages_attr);
+            pdf_out(pdf, ' ');
+        }
+        print_pdf_table_string(pdf, "pagesattributes");
+        pdf_out(pdf, ' ');
+    } else
+        pdf_dict_add_ref(pdf, "Parent", parent);
+    pdf_dict_add_int(pdf, "Count", (int) p->number_of_pages);
+    pdf_add_name(pdf, "Kids");
+    pdf_begin_array(pdf);
+    for (i = 0; i < p->number_of_kids; i++)
+        pdf_add_ref(pdf, (int) p->kids[i]);
+    pdf_end_array(pdf);
+    pdf_end_dict(pdf);
+    pdf_end_obj(pdf);
+}
+
+@ Diversion 0 is the page tree itself. It is written while pages are shipped
+out: only the path of open (not yet full) /Pages nodes from the current leaf
+up to the current top is kept in |pages_path|, and a node is written as soon
+as it is full and a sibling is needed, because then its parent is known.
+The resulting tree has the same shape as one built from all pages at the end.
+
+@c
+#define PAGES_TREE_MAXDEPTH 32
+
+static pages_entry *pages_path[PAGES_TREE_MAXDEPTH];
+static int pages_depth = 0;     /* number of levels in |pages_path| */
+
+static void flush_pages_node(PDF pdf, int level);
+
+static void add_pages_kid(PDF pdf, int level, int objnum, int number_of_pages)
+{
+    pages_entry *p;
+    while (pages_depth <= level) {
+        if (pages_depth == PAGES_TREE_MAXDEPTH)
+            overflow("pages tree depth", PAGES_TREE_MAXDEPTH);
+        pages_path[pages_depth++] = NULL;
+    }
+    p = pages_path[level];
+    if (p != NULL && p->number_of_kids == PAGES_TREE_KIDSMAX) {
+        flush_pages_node(pdf, level);
+        p = NULL;
+    }
+    if (p == NULL)
+        p = pages_path[level] = new_pages_entry(pdf);
+    p->kids[p->number_of_kids++] = objnum;
+    p->number_of_pages += number_of_pages;
+}
+
+@ Give the open node at |level| a parent, write it out and forget it.
+@c
+static void flush_pages_node(PDF pdf, int level)
+{
+    pages_entry *p = pages_path[level];
+    assert(p != NULL);
+    pages_path[level] = NULL;
+    add_pages_kid(pdf, level + 1, p->objnum, p->number_of_pages);
+    write_pages(pdf, p, pages_path[level + 1]->objnum);
+    xfree(p);
+}
+
+@ Append a list of complete leaf nodes (from another diversion) to the page
+tree, after the pages shipped so far.
+@c
+static void append_pages_list(PDF pdf, pages_entry * p)
+{
+    pages_entry *q;
+    if (pages_depth > 0 && pages_path[0] != NULL)
+        flush_pages_node(pdf, 0);
+    while (p != NULL) {
+        q = p->next;
+        add_pages_kid(pdf, 1, p->objnum, p->number_of_pages);
+        write_pages(pdf, p, pages_path[1]->objnum);
+        xfree(p);
+        p = q;
+    }
+}
+
 @ @c
 static divert_list_entry *new_divert_list_entry(void)
 {
@@ -119,6 +211,10 @@ int pdf_do_page_divert(PDF pdf, int objnum, int divnum)
     struct avl_traverser t;
     int i;
 #endif
+    if (divnum == 0) {          /* the page tree proper */
+        add_pages_kid(pdf, 0, objnum, 1);
+        return pages_path[0]->objnum;
+    }
     /* initialize the tree */
     ensure_list_tree();
     /* make sure we have a list for this diversion */
@@ -154,9 +250,14 @@ int pdf_do_page_divert(PDF pdf, int objnum, int divnum)
 }
 
 @ @c
-static void movelist(divert_list_entry * d, divert_list_entry * dto)
+static void movelist(PDF pdf, divert_list_entry * d, divert_list_entry * dto)
 {
     if (d != NULL && d->first != NULL && d->divnum != dto->divnum) {    /* no undivert of empty list or into self */
+        if (dto->divnum == 0) {
+            append_pages_list(pdf, d->first);
+            d->first = d->last = NULL;
+            return;
+        }
         if (dto->first == NULL)
             dto->first = d->first;
         else
@@ -168,7 +269,7 @@ static void movelist(divert_list_entry * d, divert_list_entry * dto)
 
 @ undivert from diversion |divnum| into diversion |curdivnum|
 @c
-void pdf_do_page_undivert(int divnum, int curdivnum)
+void pdf_do_page_undivert(PDF pdf, int divnum, int curdivnum)
 {
     divert_list_entry *d, *dto, tmp;
     struct avl_traverser t;
@@ -184,11 +285,11 @@ void pdf_do_page_undivert(int divnum, int curdivnum)
         avl_t_init(&t, divert_list_tree);
         for (d = avl_t_first(&t, divert_list_tree); d != NULL;
              d = avl_t_next(&t))
-            movelist(d, dto);
+            movelist(pdf, d, dto);
     } else {
         tmp.divnum = divnum;
         d = (divert_list_entry *) avl_find(divert_list_tree, &tmp);
-        movelist(d, dto);
+        movelist(pdf, d, dto);
     }
 #ifdef DEBUG
     printf("\n");
@@ -207,65 +308,20 @@ void pdf_do_page_undivert(int divnum, int curdivnum)
 #endif
 }
 
-@ write a /Pages object
+@ Close the open path bottom up; the topmost node becomes the /Pages root.
 @c
-#define pdf_pages_attr equiv(pdf_pages_attr_loc)
-
-static void write_pages(PDF pdf, pages_entry * p, int parent)
-{
-    int i;
-    assert(p != NULL);
-    pdf_begin_obj(pdf, p->objnum, OBJSTM_ALWAYS);
-    pdf_begin_dict(pdf);
-    pdf_dict_add_name(pdf, "Type", "Pages");
-    if (parent == 0) {          /* it's root */
-        if (pdf_pages_attr != null) {
-            pdf_print_toks(pdf, pdf_pages_attr);
-            pdf_out(pdf, ' ');
-        }
-        print_pdf_table_string(pdf, "pagesattributes");
-        pdf_out(pdf, ' ');
-    } else
-        pdf_dict_add_ref(pdf, "Parent", parent);
-    pdf_dict_add_int(pdf, "Count", (int) p->number_of_pages);
-    pdf_add_name(pdf, "Kids");
-    pdf_begin_array(pdf);
-    for (i = 0; i < p->number_of_kids; i++)
-        pdf_add_ref(pdf, (int) p->kids[i]);
-    pdf_end_array(pdf);
-    pdf_end_dict(pdf);
-    pdf_end_obj(pdf);
-}
-
-@ loop over all /Pages objects, output them, create their parents,
-recursing bottom up, return the /Pages root object number
-@c
-static int output_pages_list(PDF pdf, pages_entry * pe)
-{
-    pages_entry *p, *q, *r;
-    assert(pe != NULL);
-    if (pe->next == NULL) {     /* everything fits into one |pages_entry| */
-        write_pages(pdf, pe, 0);        /* --> /Pages root found */
-        return pe->objnum;
-    }
-    q = r = new_pages_entry(pdf);       /* one level higher needed */
-    for (p = pe; p != NULL; p = p->next) {
-        if (q->number_of_kids == PAGES_TREE_KIDSMAX) {
-            q->next = new_pages_entry(pdf);
-            q = q->next;
-        }
-        q->kids[q->number_of_kids++] = p->objnum;
-        q->number_of_pages += p->number_of_pages;
-        write_pages(pdf, p, q->objnum);
-    }
-    return output_pages_list(pdf, r);   /* recurse through next higher level */
-}
-
-@ @c
 int output_pages_tree(PDF pdf)
 {
-    divert_list_entry *d;
-    pdf_do_page_undivert(0, 0); /* concatenate all diversions into diversion 0 */
-    d = get_divert_list(0);     /* get diversion 0 */
-    return output_pages_list(pdf, d->first);
+    int level, root;
+    pdf_do_page_undivert(pdf, 0, 0);    /* append all diversions to diversion 0 */
+    assert(pages_depth > 0);
+    for (level = 0; level < pages_depth - 1; level++) {
+        if (pages_path[level] != NULL)
+            flush_pages_node(pdf, level);
+    }
+    root = pages_path[level]->objnum;
+    write_pages(pdf, pages_path[level], 0);     /* --> /Pages root found */
+    xfree(pages_path[level]);
+    pages_depth = 0;
+    return root;
 }
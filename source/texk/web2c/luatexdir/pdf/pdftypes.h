@@ -156,11 +156,6 @@ typedef struct obj_entry_ {
     int objtype;                /* integer int5 */
 } obj_entry;
 
-typedef struct dest_name_entry_ {
-    char *objname;              /* destination name */
-    int objnum;                 /* destination object number */
-} dest_name_entry;
-
 #  define pdf_max_link_level  10/* maximum depth of link nesting */
 
 typedef struct pdf_link_stack_record {
@@ -341,9 +336,7 @@ typedef struct pdf_output_file_ {
     scaledpos page_size;        /* width and height of page being shipped */
 
     /* the variables from pdfdest */
-    int dest_names_size;
-    int dest_names_ptr;
-    dest_name_entry *dest_names;
+    int dest_names_ptr;         /* number of named destinations */
     /* the (static) variables from pdfoutline */
     int first_outline;
     int last_outline;
@@ -247,6 +247,7 @@ extern void write_svnversion(char *a);
 extern halfword new_ligkern(halfword head, halfword tail);
 extern halfword handle_ligaturing(halfword head, halfword tail);
 extern halfword handle_kerning(halfword head, halfword tail);
+extern halfword handle_shaping(halfword head, halfword tail);
 
 halfword lua_hpack_filter(halfword head_node, scaled size, int pack_type,
                           int extrainfo, int d);
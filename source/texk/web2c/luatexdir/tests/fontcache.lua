@@ -0,0 +1,91 @@
+-- Checks font.save_cached and font.load_cached: a round trip, and that
+-- damaged or foreign cache files give nil instead of stopping the run.
+--
+-- usage: run by fontcache.tex, in the directory that gets the cache files
+
+local function check(ok, what)
+    if not ok then
+        texio.write_nl("fontcache: " .. what)
+        os.exit(1)
+    end
+end
+
+local function read(name)
+    local f = assert(io.open(name, "rb"))
+    local s = f:read("*a")
+    f:close()
+    return s
+end
+
+local function write(name, s)
+    local f = assert(io.open(name, "wb"))
+    f:write(s)
+    f:close()
+end
+
+local id = font.define {
+    name = "fontcache",
+    size = 655360,
+    designsize = 655360,
+    attributes = "/Test 1",
+    parameters = { slant = 0, space = 218453, space_stretch = 109226 },
+    characters = {
+        [0x41] = {
+            width = 491520, height = 450000, depth = 10000,
+            kerns = { [0x42] = -20000 },
+            ligatures = { [0x42] = { char = 0x43, type = 0 } },
+        },
+        [0x42] = { width = 400000, italic = 5000 },
+        [0x43] = { width = 800000, tounicode = "00410042" },
+    },
+}
+
+local ok, msg = font.save_cached(id, "fontcache.lfc")
+check(ok, "the font is not saved: " .. tostring(msg))
+
+local copy = font.load_cached("fontcache.lfc")
+check(copy and copy ~= id, "the cached font is not loaded")
+
+-- the defined font gives back the table it was defined with, so fields
+-- that were left out are nil there and zero in the copy
+
+local a, b = font.getfont(id), font.getfont(copy)
+check(b.name == a.name and b.size == a.size and b.designsize == a.designsize,
+    "wrong font header")
+check(b.attributes == "/Test 1", "wrong attributes")
+check(b.parameters.space == 218453 and b.parameters.space_stretch == 109226,
+    "wrong parameters")
+for c, ca in pairs(a.characters) do
+    local cb = b.characters[c]
+    check(cb, "character " .. c .. " is missing")
+    check(cb.width == ca.width and cb.height == (ca.height or 0)
+        and cb.depth == (ca.depth or 0) and cb.italic == ca.italic
+        and cb.tounicode == ca.tounicode,
+        "wrong dimensions of character " .. c)
+end
+check(b.characters[0x41].kerns[0x42] == -20000, "wrong kern")
+check(b.characters[0x41].ligatures[0x42].char == 0x43, "wrong ligature")
+
+-- damaged and foreign files
+
+local data = read("fontcache.lfc")
+local plain = zlib.decompress(data, 31)
+
+local bad = {
+    truncated = data:sub(1, math.floor(#data / 2)),
+    short = plain:sub(1, #plain - 40) .. plain:sub(-4),
+    long = plain:sub(1, #plain - 4) .. "\0\0\0\0" .. plain:sub(-4),
+    version = plain:sub(1, 20) .. "\255\255\255\255" .. plain:sub(25),
+    magic = "LuaTeX font cache 0\n" .. plain:sub(21),
+    empty = "",
+}
+for what, s in pairs(bad) do
+    write("fontcache.bad", s)
+    local i, msg = font.load_cached("fontcache.bad")
+    check(i == nil and msg, "a " .. what .. " cache file is loaded")
+end
+check(font.load_cached("fontcache.none") == nil, "a missing cache file is loaded")
+
+os.remove("fontcache.lfc")
+os.remove("fontcache.bad")
+texio.write_nl("fontcache: ok")
@@ -0,0 +1,32 @@
+-- Writes the files for inputblock.test: inputfit.tex has a first line that
+-- just fills the buffer, inputbig.tex one that is a byte longer, and
+-- inputnest.tex starts a chain of \input files that is max_in_open deep.
+--
+-- usage: luatex --luaonly inputblock.lua <buf_size> <max_in_open>
+
+local buf_size = assert(tonumber(arg[1]), "no buf_size given")
+local max_in_open = assert(tonumber(arg[2]), "no max_in_open given")
+
+local function write(name, s)
+    local f = assert(io.open(name, "wb"))
+    f:write(s)
+    f:close()
+end
+
+-- the command line (the file name) comes first in the buffer, followed by
+-- a space and the end of line position
+
+local room = buf_size - (#"inputfit" + 2)
+write("inputfit.tex", string.rep("x", room) .. "\n\\end\n")
+write("inputbig.tex", string.rep("x", room + 1) .. "\n\\end\n")
+
+-- levels 1 to max_in_open; the last one is read through an input block
+
+for k = 1, max_in_open do
+    local name = (k == 1 and "inputnest" or "inputnest" .. k)
+    if k < max_in_open then
+        write(name .. ".tex", "\\input inputnest" .. (k + 1) .. "\n\\end\n")
+    else
+        write(name .. ".tex", "\\relax\n\\relax\n")
+    end
+end
@@ -0,0 +1,135 @@
+-- Checks \mathlistcache: formulas typeset with and without the cache give
+-- the same lists, also when \thinmuskip, a \textfont or an attribute is
+-- changed in a group, and repeated formulas are taken from the cache.
+--
+-- usage: run by mathcache.tex
+
+local pt = 65536
+
+tex.enableprimitives("", tex.extraprimitives("luatex"))
+
+local function check(ok, what)
+    if not ok then
+        texio.write_nl("mathcache: " .. what)
+        os.exit(1)
+    end
+end
+
+-- a font with the parameters of a math symbol and extension font, where
+-- the characters differ in width so that a change of font shows
+
+local function mathfont(name, size)
+    local function sc(n)
+        return math.floor(n * size / 100)
+    end
+    local characters = { }
+    for c = 32, 126 do
+        characters[c] = {
+            width = sc(10 * (c % 7 + 4)),
+            height = sc(70),
+            depth = sc(20),
+            italic = sc(c % 3),
+        }
+    end
+    local parameters = {
+        slant = 0, space = 0, space_stretch = 0, space_shrink = 0,
+        x_height = sc(45), quad = size, extra_space = 0,
+    }
+    for i = 8, 22 do
+        parameters[i] = sc(10 + 2 * i)
+    end
+    local id = font.define {
+        name = name, size = size, designsize = size,
+        parameters = parameters, characters = characters,
+    }
+    tex.definefont(name, id)
+end
+
+mathfont("mca", 10 * pt)
+mathfont("mcb", 7 * pt)
+mathfont("mcc", 5 * pt)
+
+-- a description of a list, down to the glue and the attributes
+
+local function describe(n, out)
+    out = out or { }
+    while n do
+        local id = node.type(n.id)
+        local s = id .. ":" .. n.subtype .. ":" .. tostring(node.has_attribute(n, 1))
+        if id == "hlist" or id == "vlist" then
+            s = s .. ":" .. n.width .. ":" .. n.height .. ":" .. n.depth .. ":" .. n.shift
+            out[#out + 1] = s .. "["
+            describe(n.list, out)
+            s = "]"
+        elseif id == "glyph" then
+            s = s .. ":" .. n.char .. ":" .. n.font .. ":" .. n.xoffset .. ":" .. n.yoffset
+        elseif id == "glue" then
+            s = s .. ":" .. n.spec.width .. ":" .. n.spec.stretch .. ":" .. n.spec.shrink
+        elseif id == "kern" then
+            s = s .. ":" .. n.kern
+        elseif id == "rule" then
+            s = s .. ":" .. n.width .. ":" .. n.height .. ":" .. n.depth
+        elseif id == "penalty" then
+            s = s .. ":" .. n.penalty
+        elseif id == "math" then
+            s = s .. ":" .. n.surround
+        end
+        out[#out + 1] = s
+        n = n.next
+    end
+    return out
+end
+
+-- the descriptions of the lines in box |b|
+
+local function lines(b)
+    local t = { }
+    for n in node.traverse_id(node.id("hlist"), tex.box[b].list) do
+        t[#t + 1] = table.concat(describe(n.list), "\n")
+    end
+    return t
+end
+
+local hits, misses
+
+mathcache = { }
+
+function mathcache.start()
+    hits, misses = status.math_cache_hits, status.math_cache_misses
+end
+
+-- without the cache: nothing is counted, and every change makes a
+-- difference to the formulas
+
+function mathcache.uncached(b)
+    local t = lines(b)
+    check(status.math_cache_hits == hits, "a hit without the cache")
+    check(status.math_cache_misses == misses, "a miss without the cache")
+    check(#t == 5, "wrong number of lines: " .. #t)
+    check(t[1] == t[5], "the same formulas differ")
+    check(t[2] ~= t[1], "\\thinmuskip makes no difference")
+    check(t[3] ~= t[1], "the attribute makes no difference")
+    check(t[4] ~= t[1], "\\textfont makes no difference")
+end
+
+-- with the cache: the same lists
+
+function mathcache.cached(b, c)
+    local t, u = lines(b), lines(c)
+    local names = { "plain", "\\thinmuskip", "attribute", "\\textfont", "again" }
+    for i = 1, #t do
+        check(u[i] == t[i], "the cache changes the " .. names[i] .. " formulas")
+    end
+    check(status.math_cache_hits > hits, "no hits with the cache")
+    check(status.math_cache_misses > misses, "no misses with the cache")
+    hits, misses = status.math_cache_hits, status.math_cache_misses
+end
+
+-- the same formulas once more: only hits, and the same lists
+
+function mathcache.again(b, c)
+    check(status.math_cache_hits > hits, "no hits for known formulas")
+    check(status.math_cache_misses == misses, "a miss for known formulas")
+    check(lines(c)[1] == lines(b)[1], "the cache changes known formulas")
+    texio.write_nl("mathcache: ok")
+end
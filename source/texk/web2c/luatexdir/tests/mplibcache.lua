@@ -0,0 +1,133 @@
+-- Checks the result cache of mplib: hits and misses, the file digests,
+-- nested execute calls, queries after cached chunks, the run_script
+-- bypass and runs without a random seed.
+--
+-- usage: luatex --luaonly mplibcache.lua <empty directory>
+
+local dir = assert(arg[1], "no cache directory given")
+
+local function check(ok, what)
+    if not ok then
+        print("mplibcache: " .. what)
+        os.exit(1)
+    end
+end
+
+local function write(name, s)
+    local f = assert(io.open(dir .. "/" .. name, "wb"))
+    f:write(s)
+    f:close()
+end
+
+local function entries()
+    local n = 0
+    for name in lfs.dir(dir) do
+        if name:find("%.mpc$") then n = n + 1 end
+    end
+    return n
+end
+
+local reads = 0
+local nested = nil
+
+local function finder(name, mode, ftype)
+    if mode == "r" and name:find("^mpcdefs") then
+        reads = reads + 1
+        if nested then
+            nested:execute("show 1;")
+        end
+        return dir .. "/mpcdefs.mp"
+    end
+    return name
+end
+
+local chunks = {
+    "input mpcdefs;",
+    "picture p; p := nullpicture; addto p doublepath (0,0)..(u,1); shipout p; show u;",
+    "u := u + 1; show u; boolean b; b := true; string s; s := \"x\";",
+}
+
+local function digest(r)
+    local s = r.status .. "|" .. (r.term or "")
+    for _, f in ipairs(r.fig or { }) do
+        s = s .. "|" .. table.concat(f:boundingbox(), ",")
+    end
+    return s
+end
+
+local function run(query)
+    local mp = mplib.new { math_mode = "scaled", random_seed = 1, find_file = finder, cache = dir }
+    local out = { }
+    for i, c in ipairs(chunks) do
+        out[i] = digest(mp:execute(c))
+    end
+    if query then
+        query(mp)
+    end
+    mp:finish()
+    return table.concat(out, "\n")
+end
+
+write("mpcdefs.mp", "delimiters (); numeric u; u := 7;\n")
+
+-- a cold run fills the cache, a warm run does not read the input again
+
+local cold = run()
+check(reads > 0, "cold run did not read mpcdefs")
+-- (three chunks and the final run of finish)
+check(entries() == 4, "cold run stored " .. entries() .. " entries")
+check(cold:find(">> 8", 1, true), "unexpected results:\n" .. cold)
+reads = 0
+local warm = run()
+check(reads == 0, "warm run read mpcdefs " .. reads .. " times")
+check(warm == cold, "warm results differ:\n" .. cold .. "\n--\n" .. warm)
+
+-- the chunks that came from the cache are run before the instance is queried
+
+run(function(mp)
+    check(mp:get_numeric("u") == 8, "get_numeric after cached chunks")
+    check(mp:get_boolean("b") == true, "get_boolean after cached chunks")
+    check(mp:get_string("s") == "x", "get_string after cached chunks")
+end)
+
+-- a changed input file is a miss; while it is being looked up, another
+-- cached instance runs, and that must not lose the dependency
+
+write("mpcdefs.mp", "delimiters (); numeric u; u := 17;\n")
+nested = mplib.new { math_mode = "scaled", random_seed = 1, cache = dir }
+reads = 0
+local changed = run()
+check(reads > 0, "changed input was not read")
+check(changed:find(">> 18", 1, true), "stale results after a change:\n" .. changed)
+nested:finish()
+nested = nil
+write("mpcdefs.mp", "delimiters (); numeric u; u := 27;\n")
+reads = 0
+changed = run()
+check(reads > 0, "dependency lost in a nested execute")
+check(changed:find(">> 28", 1, true), "stale results after a nested execute:\n" .. changed)
+
+-- a run_script result cannot be checked, so the cache steps aside
+
+local value = "1"
+local before = entries()
+local function script()
+    local mp = mplib.new { math_mode = "scaled", random_seed = 1, extensions = 1, cache = dir,
+        run_script = function() return value end }
+    local r = mp:execute("delimiters (); show runscript \"x\";")
+    mp:finish()
+    return r.term or ""
+end
+check(script():find(">> 1", 1, true), "run_script not called")
+value = "2"
+check(script():find(">> 2", 1, true), "run_script result taken from the cache")
+check(entries() == before, "run_script results were stored")
+
+-- without a seed the random numbers come from the time
+
+local mp = mplib.new { math_mode = "scaled", cache = dir }
+mp:execute("show uniformdeviate 1;")
+mp:finish()
+check(entries() == before, "a run without a random seed was stored")
+
+print("mplibcache: ok")
@@ -0,0 +1,75 @@
+-- Checks fig:pdfcontent: a fill, a stroke with a circular pen, large
+-- coordinates, and a text object that is handed back to the caller.
+--
+-- usage: luatex --luaonly mplibpdf.lua, in the directory that gets the
+-- font metrics
+
+local function check(ok, what)
+    if not ok then
+        print("mplibpdf: " .. what)
+        os.exit(1)
+    end
+end
+
+local function u16(...)
+    local t = { }
+    for i, v in ipairs({ ... }) do
+        v = v % 0x10000
+        t[i] = string.char(math.floor(v / 256), v % 256)
+    end
+    return table.concat(t)
+end
+
+local function u32(v)
+    return u16(math.floor(v / 0x10000), v % 0x10000)
+end
+
+-- a tfm file with a 10pt design size and one character, a, half an em wide
+
+local f = assert(io.open("mplibpdf.tfm", "wb"))
+f:write(u16(14, 2, 97, 97, 2, 1, 1, 1, 0, 0, 0, 0) .. u32(0) .. u32(10 * 2^20)
+    .. string.char(1, 0, 0, 0) .. u32(0) .. u32(2^19) .. u32(0) .. u32(0) .. u32(0))
+f:close()
+
+local mp = mplib.new {
+    math_mode = "double",
+    find_file = function(name, mode, kind)
+        if kind == "tfm" then
+            return "mplibpdf.tfm"
+        end
+        return name
+    end,
+}
+
+local r = mp:execute([[
+delimiters (); def -- = {curl 1}..{curl 1} enddef;
+miterlimit := 10;
+picture p; p := nullpicture;
+addto p contour (0,0)--(10,0)--(10,10)--cycle withcolor (1,0,0);
+addto p doublepath (0,0)--(20000,30000) withpen pencircle scaled 2;
+addto p doublepath (1000000000*1000000000*1000000000,0.5) withpen pencircle;
+addto p also ("a" infont "mplibpdf");
+shipout p;
+]])
+check(r.status == 0, "the figure is not made:\n" .. tostring(r.term))
+check(r.fig and #r.fig == 1, "no figure")
+
+local content = r.fig[1]:pdfcontent()
+check(#content == 2, "wrong number of parts: " .. #content)
+check(type(content[1]) == "string", "no content before the text")
+check(type(content[2]) == "userdata" and content[2].type == "text",
+    "the text is not handed back")
+check(content[2].text == "a" and content[2].font == "mplibpdf", "wrong text object")
+
+local s = content[1]
+local function has(pattern, what)
+    check(s:find(pattern), what .. " missing from\n" .. s)
+end
+has("^q\n1 0 0 rg 1 0 0 RG\n0 0 m\n10 0 l\n10 10 l\nh\nf\nQ\n", "the fill")
+has("\nq\n0 0 0 rg 0 0 0 RG\n2 w\n0 0 m\n20000 30000 l\nS\nQ\n", "the stroke")
+has("\n1000000000000000013287555072 0.5 m\n1000000000000000013287555072 0.5 l\nS\n",
+    "the large coordinates")
+check(not s:find(" M\n"), "a miter limit that is the default")
+
+mp:finish()
+print("mplibpdf: ok")
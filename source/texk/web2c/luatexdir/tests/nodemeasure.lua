@@ -0,0 +1,103 @@
+-- Checks node.direct.measure: the natural dimensions and the glue totals
+-- of a list, with and without a tail node, against what hpack makes of it.
+--
+-- usage: run by nodemeasure.tex
+
+local direct = node.direct
+
+local function check(ok, what)
+    if not ok then
+        texio.write_nl("nodemeasure: " .. what)
+        os.exit(1)
+    end
+end
+
+local function rule(w, h, d)
+    local n = direct.new("rule")
+    direct.setfield(n, "width", w)
+    direct.setfield(n, "height", h)
+    direct.setfield(n, "depth", d)
+    return n
+end
+
+local function kern(w)
+    local n = direct.new("kern", 1)
+    direct.setfield(n, "kern", w)
+    return n
+end
+
+local function glue(w, st, sto, sh, sho)
+    local n = direct.new("glue")
+    local s = direct.new("glue_spec")
+    direct.setfield(s, "width", w)
+    direct.setfield(s, "stretch", st)
+    direct.setfield(s, "stretch_order", sto)
+    direct.setfield(s, "shrink", sh)
+    direct.setfield(s, "shrink_order", sho)
+    direct.setfield(n, "spec", s)
+    return n
+end
+
+local function list(...)
+    local t = { ... }
+    for i = 2, #t do
+        direct.setfield(t[i - 1], "next", t[i])
+        direct.setfield(t[i], "prev", t[i - 1])
+    end
+    return t[1]
+end
+
+-- a list with finite glue only
+
+local inner = direct.hpack(list(rule(100, 900, 50), glue(10, 20, 0, 30, 0)))
+local head = list(
+    rule(1000, 2000, 300),
+    glue(500, 200, 0, 100, 0),
+    kern(-40),
+    inner,
+    glue(600, 300, 0, 50, 0),
+    rule(2000, 1000, 700))
+
+local w, h, d, st, sto, sh, sho = direct.measure(head)
+check(w == 1000 + 500 - 40 + 110 + 600 + 2000, "wrong width")
+check(h == 2000 and d == 700, "wrong height or depth")
+check(st == 500 and sto == 0, "wrong finite stretch")
+check(sh == 150 and sho == 0, "wrong finite shrink")
+
+-- the same as dimensions
+
+local dw, dh, dd = direct.dimensions(head)
+check(dw == w and dh == h and dd == d, "not the same as dimensions")
+
+-- with a tail, which is not included
+
+local tail = direct.getnext(direct.getnext(head))
+w, h, d, st, sto, sh, sho = direct.measure(head, tail)
+check(w == 1500 and h == 2000 and d == 300, "wrong dimensions up to the tail")
+check(st == 200 and sh == 100, "wrong glue totals up to the tail")
+
+-- the highest order wins, per stretch and shrink
+
+local last = direct.tail(head)
+local fil = list(glue(0, 65536, 2, 0, 0), glue(0, 2 * 65536, 2, 20, 1),
+    glue(0, 7, 1, 0, 0))
+direct.setfield(last, "next", fil)
+direct.setfield(fil, "prev", last)
+
+w, h, d, st, sto, sh, sho = direct.measure(head, "TLT")
+check(st == 3 * 65536 and sto == 2, "wrong fil stretch")
+check(sh == 20 and sho == 1, "wrong fi shrink")
+
+-- hpack agrees on the orders
+
+local copy = direct.copy_list(head)
+local box = direct.hpack(copy, w + 100, "exactly")
+check(direct.getfield(box, "glue_order") == sto, "hpack uses another stretch order")
+direct.flush_node(box)
+copy = direct.copy_list(head)
+box = direct.hpack(copy, w - 10, "exactly")
+check(direct.getfield(box, "glue_order") == sho, "hpack uses another shrink order")
+direct.flush_node(box)
+
+direct.flush_list(head)
+texio.write_nl("nodemeasure: ok")
@@ -0,0 +1,153 @@
+-- Checks tex.pagebreak: the chosen breakpoints of a vertical list, forced
+-- breaks, infinite glue, a table of page heights, and that the list is left
+-- alone.
+--
+-- usage: run by pagebreak.tex
+
+local pt = 65536
+
+local function check(ok, what)
+    if not ok then
+        texio.write_nl("pagebreak: " .. what)
+        os.exit(1)
+    end
+end
+
+local function box(h)
+    local n = node.new("hlist")
+    n.height = h
+    n.width = 100 * pt
+    return n
+end
+
+local function glue(w, st, order)
+    local n = node.new("glue")
+    local s = node.new("glue_spec")
+    s.width = w
+    s.stretch = st
+    s.stretch_order = order or 0
+    n.spec = s
+    return n
+end
+
+local function penalty(p)
+    local n = node.new("penalty")
+    n.penalty = p
+    return n
+end
+
+-- boxes of 10pt with 2pt plus 2pt glue between them (or plus 1fil when
+-- |order| is 2), and optional extra nodes after box i
+
+local function column(n, extra, order)
+    local head, tail
+    for i = 1, n do
+        local b = box(10 * pt)
+        if head then
+            local g = glue(2 * pt, order and pt or 2 * pt, order)
+            tail.next = g
+            g.next = b
+        else
+            head = b
+        end
+        tail = b
+        if extra and extra[i] then
+            tail.next = extra[i]
+            tail = extra[i]
+        end
+    end
+    return head
+end
+
+-- the number of boxes on each page
+
+local function pages(head, breaks)
+    local counts, k, n = { }, 1, 0
+    for p in node.traverse(head) do
+        if p.id == node.id("hlist") then
+            n = n + 1
+        end
+        if p == breaks[k] then
+            counts[#counts + 1] = n
+            n, k = 0, k + 1
+        end
+    end
+    counts[#counts + 1] = n
+    return table.concat(counts, " ")
+end
+
+-- three boxes fit a 35pt page; pages of two boxes can not stretch enough
+
+local head = column(9)
+local length = node.length(head)
+local breaks, info = tex.pagebreak(head, { height = 35 * pt })
+check(info.pages == 3 and #breaks == 2, "wrong number of pages")
+check(breaks[1].id == node.id("glue") and breaks[2].id == node.id("glue"),
+    "breaks are not at glue")
+check(pages(head, breaks) == "3 3 3", "wrong pages: " .. pages(head, breaks))
+check(info.demerits < 10000, "wrong demerits")
+check(node.length(head) == length, "the list is changed")
+
+-- a forced break is taken, and the rest is still balanced
+
+node.flush_list(head)
+head = column(9, { [2] = penalty(-10000) })
+breaks, info = tex.pagebreak(head, { height = 35 * pt })
+check(breaks[1].id == node.id("penalty") and breaks[1].penalty == -10000,
+    "the forced break is not taken")
+check(pages(head, breaks) == "2 3 3 1",
+    "wrong pages after a forced break: " .. pages(head, breaks))
+
+-- with fil glue every page has badness zero; the page penalty still makes
+-- fewer pages better, also against a negative penalty after every box
+
+node.flush_list(head)
+head = column(9, nil, 2)
+breaks, info = tex.pagebreak(head, { height = 35 * pt, pagepenalty = 10 })
+check(pages(head, breaks) == "3 3 3", "wrong pages with fil glue: "
+    .. pages(head, breaks))
+check(info.demerits == 300, "wrong demerits with fil glue: " .. info.demerits)
+node.flush_list(head)
+local extra = { }
+for i = 1, 8 do
+    extra[i] = penalty(-5)
+end
+head = column(9, extra, 2)
+breaks, info = tex.pagebreak(head, { height = 35 * pt, pagepenalty = 10 })
+check(pages(head, breaks) == "3 3 3", "wrong pages with fil glue and penalties: "
+    .. pages(head, breaks))
+
+-- the page heights must be numbers
+
+node.flush_list(head)
+head = column(3)
+check(not pcall(tex.pagebreak, head, { height = { 35 * pt, "x" } }),
+    "a page height that is not a number is accepted")
+
+-- a list that fits gives one page and no breaks
+
+node.flush_list(head)
+head = column(3)
+breaks, info = tex.pagebreak(head, { height = 35 * pt })
+check(info.pages == 1 and #breaks == 0, "a short list is broken")
+
+-- page heights: the first page is short, the last height repeats
+
+node.flush_list(head)
+head = column(8)
+breaks, info = tex.pagebreak(head, { height = { 22 * pt, 35 * pt } })
+check(pages(head, breaks) == "2 3 3", "wrong pages with two heights: "
+    .. pages(head, breaks))
+
+-- a box that is too tall gives an overfull page, not an error; it costs
+-- awful_bad, where deplorable is only 100000
+
+node.flush_list(head)
+head = column(4)
+head.next.next.height = 50 * pt
+breaks, info = tex.pagebreak(head, { height = 35 * pt })
+check(info.pages >= 2 and info.demerits > 1000000000,
+    "no overfull page for a tall box")
+
+node.flush_list(head)
+texio.write_nl("pagebreak: ok")
@@ -0,0 +1,176 @@
+-- Checks font.read_sfnt on a small font that is put together here: the
+-- cmap, the advances, a version 0 OS/2 table, the GSUB features, the GDEF
+-- glyph classes, the MATH constants, and a name record that points past
+-- the end of its table.
+--
+-- usage: luatex --luaonly sfnt.lua <font file to write>
+
+local name = assert(arg[1], "no font file given")
+
+local function check(ok, what)
+    if not ok then
+        print("sfnt: " .. what)
+        os.exit(1)
+    end
+end
+
+local function u16(...)
+    local t = { }
+    for i, v in ipairs({ ... }) do
+        v = v % 0x10000
+        t[i] = string.char(math.floor(v / 256), v % 256)
+    end
+    return table.concat(t)
+end
+
+local function u32(v)
+    return u16(math.floor(v / 0x10000), v % 0x10000)
+end
+
+local function pad(s, n)
+    return s .. string.rep("\0", n - #s)
+end
+
+-- glyphs: 0 .notdef, 1 A, 2 B, 3 acutecomb, 4 f_f
+
+local tables = { }
+
+tables.head = u32(0x00010000) .. u32(0x00010000) .. u32(0) .. u32(0x5F0F3CF5)
+    .. u16(0, 1000) .. string.rep("\0", 16)
+    .. u16(-50, -200, 950, 800, 0, 8, 2, 0, 0)
+
+tables.hhea = u32(0x00010000) .. u16(800, -200, 90, 700, 0, 0, 700, 1, 0, 0)
+    .. u16(0, 0, 0, 0, 0, 5)
+
+tables.maxp = u32(0x00005000) .. u16(5)
+
+tables.hmtx = u16(500, 0, 600, 10, 620, 10, 0, 0, 700, 20)
+
+tables["OS/2"] = pad(u16(0, 550, 700, 3), 78)
+
+tables.cmap = u16(0, 1, 3, 1) .. u32(12)
+    .. u16(4, 40, 0, 6, 4, 1, 2)
+    .. u16(0x42, 0x301, 0xFFFF) .. u16(0)
+    .. u16(0x41, 0x301, 0xFFFF)
+    .. u16(1 - 0x41, 3 - 0x301, 1)
+    .. u16(0, 0, 0)
+
+local fontname = "SfntTest"
+tables.name = u16(0, 1, 18, 3, 1, 0x409, 6, 2 * #fontname, 0)
+    .. fontname:gsub(".", "\0%0")
+
+-- scripts DFLT (liga) and latn (liga smcp, and TRK with liga as the
+-- required feature); no lookups
+
+tables.GSUB = u32(0x00010000) .. u16(10, 64, 86)
+    .. u16(2) .. "DFLT" .. u16(14) .. "latn" .. u16(26)
+    .. u16(4, 0) .. u16(0, 0xFFFF, 1, 0)
+    .. u16(10, 1) .. "TRK " .. u16(20)
+    .. u16(0, 0xFFFF, 2, 0, 1)
+    .. u16(0, 0, 1, 1)
+    .. u16(2) .. "liga" .. u16(14) .. "smcp" .. u16(18)
+    .. u16(0, 0) .. u16(0, 0)
+    .. u16(0)
+
+-- class format 2: A B base, acutecomb mark, f_f ligature
+
+tables.GDEF = u32(0x00010000) .. u16(12, 0, 0, 0)
+    .. u16(2, 3, 1, 2, 1, 3, 3, 3, 4, 4, 2)
+
+local constants = { }
+for i = 1, 56 do
+    constants[i] = i * 10
+end
+constants[1], constants[2], constants[56] = 70, 50, 60
+constants[6] = -250
+
+local math_constants = { u16(constants[1], constants[2], constants[3], constants[4]) }
+for i = 5, 55 do
+    math_constants[#math_constants + 1] = u16(constants[i], 0)
+end
+math_constants[#math_constants + 1] = u16(constants[56])
+tables.MATH = u32(0x00010000) .. u16(10, 0, 0) .. table.concat(math_constants)
+
+local function write()
+    local tags = { }
+    for tag in pairs(tables) do
+        tags[#tags + 1] = tag
+    end
+    table.sort(tags)
+    local directory = { u32(0x00010000), u16(#tags, 0, 0, 0) }
+    local data = { }
+    local offset = 12 + 16 * #tags
+    for _, tag in ipairs(tags) do
+        local t = tables[tag]
+        directory[#directory + 1] = tag .. u32(0) .. u32(offset) .. u32(#t)
+        t = pad(t, 4 * math.ceil(#t / 4))
+        data[#data + 1] = t
+        offset = offset + #t
+    end
+    local f = assert(io.open(name, "wb"))
+    f:write(table.concat(directory) .. table.concat(data))
+    f:close()
+end
+
+write()
+
+local sfnt, msg = font.read_sfnt(name)
+check(sfnt, "the font is not read: " .. tostring(msg))
+
+local info = sfnt:info()
+check(info.format == "truetype", "wrong format")
+check(info.fontname == fontname, "wrong font name")
+check(info.glyphs == 5, "wrong number of glyphs")
+check(info.units_per_em == 1000, "wrong units per em")
+check(info.weight == 700 and info.width == 3, "the version 0 OS/2 table is not read")
+check(info.xheight == nil, "an x-height from a version 0 OS/2 table")
+
+check(sfnt:glyph(0x41) == 1 and sfnt:glyph(0x42) == 2 and sfnt:glyph(0x301) == 3,
+    "wrong cmap lookup")
+check(sfnt:glyph(0x43) == nil, "an unmapped character has a glyph")
+local unicodes = sfnt:unicodes()
+check(unicodes[0x41] == 1 and unicodes[0x301] == 3 and unicodes[0xFFFF] == nil,
+    "wrong unicodes")
+
+check(sfnt:advance(1) == 600 and sfnt:advance(4) == 700, "wrong advances")
+check(sfnt:advance(5) == nil, "an advance beyond the last glyph")
+
+local features = sfnt:features("GSUB")
+check(features, "no GSUB features")
+check(features.DFLT.dflt[1] == "liga" and #features.DFLT.dflt == 1,
+    "wrong DFLT features")
+check(table.concat(features.latn.dflt, " ") == "liga smcp", "wrong latn features")
+check(table.concat(features.latn["TRK "], " ") == "smcp liga",
+    "wrong features with a required feature")
+check(sfnt:features("GPOS") == nil, "GPOS features without a GPOS table")
+check(not pcall(sfnt.features, sfnt, "GDEF"), "features of a GDEF table")
+
+check(sfnt:glyphclass(1) == "base" and sfnt:glyphclass(2) == "base", "wrong base class")
+check(sfnt:glyphclass(3) == "mark", "wrong mark class")
+check(sfnt:glyphclass(4) == "ligature", "wrong ligature class")
+check(sfnt:glyphclass(0) == nil, "a class for .notdef")
+
+local mc = sfnt:mathconstants()
+check(mc, "no math constants")
+check(mc.ScriptPercentScaleDown == 70 and mc.ScriptScriptPercentScaleDown == 50,
+    "wrong script percentages")
+check(mc.DelimitedSubFormulaMinHeight == 30 and mc.DisplayOperatorMinHeight == 40,
+    "wrong minimum heights")
+check(mc.AxisHeight == -250, "wrong axis height")
+check(mc.RadicalKernAfterDegree == 550, "wrong last value record")
+check(mc.RadicalDegreeBottomRaisePercent == 60, "wrong radical degree raise")
+
+check(#sfnt:table("OS/2") == 78, "wrong OS/2 table")
+sfnt:close()
+check(not pcall(sfnt.info, sfnt), "a closed font can be used")
+
+-- a name whose string is not in the table is left out
+
+tables.name = u16(0, 1, 18, 3, 1, 0x409, 6, 2 * #fontname, 200)
+    .. fontname:gsub(".", "\0%0")
+write()
+sfnt = font.read_sfnt(name)
+check(sfnt and sfnt:info().fontname == nil, "a name from outside the name table")
+sfnt:close()
+
+os.remove(name)
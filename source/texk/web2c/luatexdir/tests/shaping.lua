@@ -0,0 +1,209 @@
+-- Checks font.setshaping and node.shaping on a small font with GSUB and
+-- GPOS lookups that is put together here: a ligature, a single
+-- substitution, a pair kern and a mark attached to a base.
+--
+-- usage: run by shaping.tex, in the directory that gets the font file
+
+local pt = 65536
+
+local function check(ok, what)
+    if not ok then
+        texio.write_nl("shaping: " .. what)
+        os.exit(1)
+    end
+end
+
+local function u16(...)
+    local t = { }
+    for i, v in ipairs({ ... }) do
+        v = v % 0x10000
+        t[i] = string.char(math.floor(v / 256), v % 256)
+    end
+    return table.concat(t)
+end
+
+local function u32(v)
+    return u16(math.floor(v / 0x10000), v % 0x10000)
+end
+
+local function pad(s, n)
+    return s .. string.rep("\0", n - #s)
+end
+
+-- glyphs: 0 .notdef, 1 A, 2 V, 3 f, 4 i, 5 f_i, 6 b, 7 B, 8 acutecomb
+
+local glyphs = { [0x41] = 1, [0x56] = 2, [0x66] = 3, [0x69] = 4, [0xFB01] = 5,
+    [0x62] = 6, [0x42] = 7, [0x301] = 8 }
+
+-- a count and records of a tag (or nothing) and an offset, followed by
+-- the data the records point at
+
+local function records(list)
+    local head, body = { u16(#list) }, { }
+    local offset = 2
+    for _, t in ipairs(list) do
+        offset = offset + #t[1] + 2
+    end
+    for i, t in ipairs(list) do
+        head[i + 1] = t[1] .. u16(offset)
+        body[i] = t[2]
+        offset = offset + #t[2]
+    end
+    return table.concat(head) .. table.concat(body)
+end
+
+-- a layout table with the DFLT script only, whose default language system
+-- has all features; |features| is a list of { tag, lookup index }, and
+-- |lookups| a list of { type, subtable }
+
+local function layout(features, lookups)
+    local langsys = u16(0, 0xFFFF, #features)
+    local list = { }
+    for i, f in ipairs(features) do
+        langsys = langsys .. u16(i - 1)
+        list[i] = { f[1], u16(0, 1, f[2]) }
+    end
+    local scripts = u16(1) .. "DFLT" .. u16(8) .. u16(4, 0) .. langsys
+    local featurelist = records(list)
+    list = { }
+    for i, l in ipairs(lookups) do
+        list[i] = { "", u16(l[1], 0, 1, 8) .. l[2] }
+    end
+    local lookuplist = records(list)
+    return u32(0x00010000) .. u16(10, 10 + #scripts, 10 + #scripts + #featurelist)
+        .. scripts .. featurelist .. lookuplist
+end
+
+local tables = { }
+
+tables.head = u32(0x00010000) .. u32(0x00010000) .. u32(0) .. u32(0x5F0F3CF5)
+    .. u16(0, 1000) .. string.rep("\0", 16)
+    .. u16(-50, -200, 950, 800, 0, 8, 2, 0, 0)
+
+tables.hhea = u32(0x00010000) .. u16(800, -200, 90, 700, 0, 0, 700, 1, 0, 0)
+    .. u16(0, 0, 0, 0, 0, 1)
+
+tables.maxp = u32(0x00005000) .. u16(9)
+
+tables.hmtx = u16(500, 0)
+
+-- liga: f i -> f_i; smcp: b -> B
+
+tables.GSUB = layout({ { "liga", 0 }, { "smcp", 1 } }, {
+    { 4, u16(1, 8, 1, 14) .. u16(1, 1, 3) .. u16(1, 4) .. u16(5, 2, 4) },
+    { 1, u16(2, 8, 1, 7) .. u16(1, 1, 6) },
+})
+
+-- kern: A V moves V 80 units to the left; mark: the acute goes from its
+-- anchor (150,500) to the anchor (300,700) of A
+
+tables.GPOS = layout({ { "kern", 0 }, { "mark", 1 } }, {
+    { 2, u16(1, 12, 4, 0, 1, 18) .. u16(1, 1, 1) .. u16(1, 2, -80) },
+    { 4, u16(1, 12, 18, 1, 24, 36) .. u16(1, 1, 8) .. u16(1, 1, 1)
+        .. u16(1, 0, 6) .. u16(1, 150, 500) .. u16(1, 4) .. u16(1, 300, 700) },
+})
+
+-- class format 1: base, base, base, base, ligature, base, base, mark
+
+tables.GDEF = u32(0x00010000) .. u16(12, 0, 0, 0)
+    .. u16(1, 1, 8, 1, 1, 1, 1, 2, 1, 1, 3)
+
+local tags = { }
+for tag in pairs(tables) do
+    tags[#tags + 1] = tag
+end
+table.sort(tags)
+
+local directory = { u32(0x00010000), u16(#tags, 0, 0, 0) }
+local data = { }
+local offset = 12 + 16 * #tags
+for _, tag in ipairs(tags) do
+    local t = tables[tag]
+    directory[#directory + 1] = tag .. u32(0) .. u32(offset) .. u32(#t)
+    t = pad(t, 4 * math.ceil(#t / 4))
+    data[#data + 1] = t
+    offset = offset + #t
+end
+
+local f = assert(io.open("shaping.ttf", "wb"))
+f:write(table.concat(directory) .. table.concat(data))
+f:close()
+
+local sfnt, msg = font.read_sfnt("shaping.ttf")
+check(sfnt, "the font is not read: " .. tostring(msg))
+
+-- one unit is 655.36sp at 10pt
+
+local characters = { }
+for c, g in pairs(glyphs) do
+    characters[c] = { width = (c == 0x301 and 0 or 6 * pt), height = 7 * pt, index = g }
+end
+local id = font.define {
+    name = "shaping", size = 10 * pt, designsize = 10 * pt, units_per_em = 1000,
+    parameters = { slant = 0, space = 0 }, characters = characters,
+}
+
+local n = font.setshaping(id, sfnt, { features = { "liga", "smcp", "kern", "mark" } })
+check(n == 4, "wrong number of lookups: " .. tostring(n))
+sfnt:close()
+
+local function shape(...)
+    local head, tail
+    for _, c in ipairs({ ... }) do
+        local g = node.new("glyph", 1)
+        g.font = id
+        g.char = c
+        if head then
+            tail.next = g
+            g.prev = tail
+        else
+            head = g
+        end
+        tail = g
+    end
+    local h, t, success = node.shaping(head, tail)
+    check(success, "shaping failed")
+    local list = { }
+    for p in node.traverse(h) do
+        list[#list + 1] = p
+    end
+    check(list[#list] == t, "wrong tail")
+    return list
+end
+
+-- a ligature that keeps its components
+
+local l = shape(0x66, 0x69)
+check(#l == 1 and l[1].char == 0xFB01, "no ligature")
+check(l[1].subtype % 4 == 2, "the ligature is not marked as one")
+local c = l[1].components
+check(c and c.char == 0x66 and c.next and c.next.char == 0x69 and not c.next.next,
+    "wrong ligature components")
+
+-- a single substitution
+
+l = shape(0x62)
+check(#l == 1 and l[1].char == 0x42, "no single substitution")
+
+-- a pair kern, as a font kern after the first glyph
+
+l = shape(0x41, 0x56)
+check(#l == 3 and l[1].char == 0x41 and l[3].char == 0x56, "no kern between A and V")
+check(l[2].id == node.id("kern") and l[2].subtype == 0 and l[2].kern == -52429,
+    "wrong kern: " .. tostring(l[2].kern))
+
+-- a mark attachment: the acute comes after A and is moved back over it
+
+l = shape(0x41, 0x301)
+check(#l == 2 and l[2].char == 0x301, "the mark is lost")
+check(l[2].xoffset == -6 * pt + 98304 and l[2].yoffset == 131072,
+    "wrong mark offsets: " .. l[2].xoffset .. " " .. l[2].yoffset)
+check(l[1].xoffset == 0 and l[1].yoffset == 0, "the base is moved")
+
+-- without shaping data nothing happens
+
+font.setshaping(id)
+l = shape(0x66, 0x69)
+check(#l == 2 and l[1].char == 0x66, "shaped without shaping data")
+
+texio.write_nl("shaping: ok")
@@ -807,6 +807,11 @@ void fin_align(void)
     halfword n;                 /* matching span amount */
     scaled rule_save;           /* temporary storage for |overfull_rule| */
     halfword pd;                /* temporary storage for |prev_depth| */
+    int j, k;                   /* column numbers */
+    int ncols;                  /* the number of columns in the prototype */
+    scaled *col_width;          /* the final column widths */
+    scaled *col_edge;           /* where each column ends */
+    halfword *col_glue;         /* the tabskip glue after each column */
     if (cur_group != align_group)
         confusion("align1");
     unsave();                   /* that |align_group| was for individual entries */
@@ -941,6 +946,40 @@ value is changed to zero and so is the next tabskip.
     }
     pack_begin_line = 0;
 
+    /* Copy the column widths and tabskip glue of the prototype into arrays */
+    /* Every row needs the widths of its columns, and a spanned entry needs the
+       distance from the start of its first column to the end of its last one,
+       so these are computed once here. The edge of column~|j| is the sum of the
+       widths of the columns and of the set tabskip glue up to and including
+       column~|j|, measured from the start of the first column. The tabskip
+       amounts are rounded the same way for every row, so an entry spanning
+       columns $i$ through~$j$ is |col_edge[j]-col_edge[i]+col_width[i]| wide.
+     */
+    ncols = 0;
+    for (q = vlink(list_ptr(p)); q != null; q = vlink(vlink(q)))
+        incr(ncols);
+    col_width = xmalloc((unsigned) ncols * sizeof(scaled));
+    col_edge = xmalloc((unsigned) ncols * sizeof(scaled));
+    col_glue = xmalloc((unsigned) ncols * sizeof(halfword));
+    t = 0;
+    j = 0;
+    for (q = vlink(list_ptr(p)); q != null; q = vlink(vlink(q))) {
+        v = glue_ptr(vlink(q));
+        col_width[j] = width(q);
+        col_glue[j] = v;
+        t = t + width(q);
+        col_edge[j] = t;
+        t = t + width(v);
+        if (glue_sign(p) == stretching) {
+            if (stretch_order(v) == glue_order(p))
+                t = t + round(float_cast(glue_set(p)) * float_cast(stretch(v)));
+        } else if (glue_sign(p) == shrinking) {
+            if (shrink_order(v) == glue_order(p))
+                t = t - round(float_cast(glue_set(p)) * float_cast(shrink(v)));
+        }
+        incr(j);
+    }
+
     /* Set the glue in all the unset boxes of the current list */
     q = vlink(cur_list.head_field);
     s = cur_list.head_field;
@@ -966,7 +1005,7 @@ value is changed to zero and so is the next tabskip.
                 shift_amount(q) = o;
                 r = vlink(list_ptr(q));
                 assert (type(r) == unset_node);
-                s = vlink(list_ptr(p));
+                j = 0;
                 do {
                     /* Set the glue in node |r| and change it from an unset node */
                     /* A box made from spanned columns will be followed by tabskip glue nodes and
@@ -975,45 +1014,26 @@ value is changed to zero and so is the next tabskip.
                        arithmetic from entering into the dimensions of any boxes.
                      */
                     n = span_count(r);
-                    t = width(s);
-                    w = t;
+                    w = col_width[j];
+                    t = col_edge[j + n] - col_edge[j] + w;
                     u = hold_head;
-                    while (n > min_quarterword) {
-                        decr(n);
-                        /* Append tabskip glue and an empty box to list |u|,
-                           and update |s| and |t| as the prototype nodes are passed */
-
-                        s = vlink(s);
-                        v = glue_ptr(s);
-                        vlink(u) = new_glue(v);
+                    for (k = j + 1; k <= j + n; k++) {
+                        /* Append tabskip glue and an empty box to list |u| */
+                        vlink(u) = new_glue(col_glue[k - 1]);
                         u = vlink(u);
                         subtype(u) = tab_skip_code + 1;
-                        t = t + width(v);
-                        if (glue_sign(p) == stretching) {
-                            if (stretch_order(v) == glue_order(p))
-                                t = t +
-                                    round(float_cast(glue_set(p)) *
-                                          float_cast(stretch(v)));
-                        } else if (glue_sign(p) == shrinking) {
-                            if (shrink_order(v) == glue_order(p))
-                                t = t -
-                                    round(float_cast(glue_set(p)) *
-                                          float_cast(shrink(v)));
-                        }
-                        s = vlink(s);
                         rr = new_null_box();
                         vlink(u) = rr;
                         u = vlink(u);
-                        t = t + width(s);
                         subtype(u) = HLIST_SUBTYPE_ALIGNCELL;
                         if (cur_list.mode_field == -vmode) {
-                            width(u) = width(s);
+                            width(u) = col_width[k];
                         } else {
                             type(u) = vlist_node;
-                            height(u) = width(s);
+                            height(u) = col_width[k];
                         }
-
                     }
+                    j = j + n + 1;
                     if (cur_list.mode_field == -vmode) {
                         /* Make the unset node |r| into an |hlist_node| of width |w|,
                            setting the glue as if the width were |t| */
@@ -1091,7 +1111,6 @@ value is changed to zero and so is the next tabskip.
                     }
 
                     r = vlink(vlink(r));
-                    s = vlink(vlink(s));
                 } while (r != null);
 
             } else if (type(q) == rule_node) {
@@ -1117,6 +1136,9 @@ value is changed to zero and so is the next tabskip.
         s = q;
         q = vlink(q);
     }
+    xfree(col_glue);
+    xfree(col_edge);
+    xfree(col_width);
     flush_node_list(p);
     pop_alignment();
     /* Insert the current list into its environment */
@@ -21,6 +21,10 @@
 #ifndef DUMPDATA_H
 #  define DUMPDATA_H
 
+/* 907 = sum of the values of the bytes of "don knuth" */
+/* The next FORMAT_ID will be 907+5               */
+#  define FORMAT_ID (907+4)
+
 extern str_number format_ident;
 extern str_number format_name;  /* principal file name */
 extern FILE *fmt_file;          /* for input or output of format information */
@@ -25,9 +25,6 @@
 #define font_id_text(A) cs_text(font_id_base+(A))
 #define prev_depth cur_list.prev_depth_field
 
-/* 907 = sum of the values of the bytes of "don knuth" */
-/* The next FORMAT_ID will be 907+3               */
-#define FORMAT_ID (907+2)  
 #if ((FORMAT_ID>=0) && (FORMAT_ID<=256))
 #error Wrong value for FORMAT_ID.
 #endif
@@ -87,6 +84,7 @@ void store_fmt_file(void)
     if (callback_id > 0) {
         (void) run_callback(callback_id, "->");
     }
+    flush_math_list_cache();
     selector = new_string;
     tprint(" (format=");
     print(job_name);
@@ -497,6 +495,7 @@ boolean load_fmt_file(const char *fmtname)
             print_csnames(eqtb_size + 1, hash_high - (eqtb_size + 1));
     }
     undump_int(cs_count);
+    rebuild_cs_index();
 
     /* Undump the font information */
     undump_int(x);
@@ -710,18 +710,28 @@ void save_for_after(halfword t)
 This routine takes care of restoration when a level ends; everything
 belonging to the topmost group is cleared off of the save stack.
 
+Most groups change nothing in the code tables, so these are only visited
+when |sa_stack_level| says that one of them may hold entries for this level.
+Whether restores are traced is looked up once, and again only when
+\.{\\tracingrestores} itself is restored.
+
 @c
 void unsave(void)
 {                               /* pops the top level off the save stack */
     halfword p;                 /* position to be restored */
     quarterword l;              /* saved level, if in fullword regions of |eqtb| */
     boolean a;                  /* have we already processed an \.{\\aftergroup} ? */
+    boolean tracing;            /* are restores traced? */
     a = false;
     l = level_one;              /* just in case */
-    unsave_math_codes(cur_level);
-    unsave_cat_codes(int_par(cat_code_table_code), cur_level);
-    unsave_text_codes(cur_level);
-    unsave_math_data(cur_level);
+    if (sa_stack_level >= cur_level) {
+        unsave_math_codes(cur_level);
+        unsave_cat_codes(int_par(cat_code_table_code), cur_level);
+        unsave_text_codes(cur_level);
+        unsave_math_data(cur_level);
+        sa_stack_level = cur_level - 1;
+    }
+    tracing = (int_par(tracing_restores_code) > 0);
     if (cur_level > level_one) {
         decr(cur_level);
         /* Clear off top level from |save_stack| */
@@ -749,21 +759,23 @@ void unsave(void)
                 if (p < int_base || p > eqtb_size) {
                     if (eq_level(p) == level_one) {
                         eq_destroy(save_word(save_ptr));        /* destroy the saved value */
-                        if (int_par(tracing_restores_code) > 0)
+                        if (tracing)
                             restore_trace(p, "retaining");
                     } else {
                         eq_destroy(eqtb[p]);    /* destroy the current value */
                         eqtb[p] = save_word(save_ptr);  /* restore the saved value */
-                        if (int_par(tracing_restores_code) > 0)
+                        if (tracing)
                             restore_trace(p, "restoring");
                     }
                 } else if (xeq_level[p] != level_one) {
                     eqtb[p] = save_word(save_ptr);
                     xeq_level[p] = l;
-                    if (int_par(tracing_restores_code) > 0)
+                    if (p == int_base + tracing_restores_code)
+                        tracing = (int_par(tracing_restores_code) > 0);
+                    if (tracing)
                         restore_trace(p, "restoring");
                 } else {
-                    if (int_par(tracing_restores_code) > 0)
+                    if (tracing)
                         restore_trace(p, "retaining");
                 }
 
@@ -553,6 +553,55 @@ void macro_call(void)
                 p = temp_token_head;
                 m = 0;
             }
+            if ((s != null) && (token_info(s) >= match_token)
+                && (token_info(s) <= end_match_token)) {
+                /* Scan an undelimited parameter without the matching machinery */
+                /* Most parameters are undelimited, and then the general loop below
+                   boils down to skipping blanks and taking either one token or one
+                   balanced group. We do that directly, and hand anything unusual
+                   (a \.{\\par} or a stray right brace) to the general code, which
+                   picks up right after its |get_token|. */
+                do {
+                    get_token();
+                } while (cur_tok == space_token);
+                if (cur_tok >= right_brace_limit) {
+                    if (cur_tok == par_token)
+                        goto SCANNED;
+                    fast_store_new_token(cur_tok);
+                    pstack[n] = token_link(temp_token_head);
+                    goto TUCKED;
+                } else if (cur_tok < left_brace_limit) {
+                    /* the left brace is kept until the group is complete, so that
+                       a runaway argument shows up as usual */
+                    fast_store_new_token(cur_tok);
+                    unbalance = 1;
+                    while (1) {
+                        get_token();
+                        if (cur_tok == par_token) {
+                            if (long_state != long_call_cmd) {
+                                if (!int_par(suppress_long_error_code)) {
+                                    goto RUNAWAY;
+                                }
+                            }
+                        } else if (cur_tok < right_brace_limit) {
+                            if (cur_tok < left_brace_limit) {
+                                incr(unbalance);
+                            } else {
+                                decr(unbalance);
+                                if (unbalance == 0)
+                                    break;
+                            }
+                        }
+                        fast_store_new_token(cur_tok);
+                    }
+                    q = token_link(temp_token_head);
+                    pstack[n] = token_link(q);
+                    free_avail(q);
+                    goto TUCKED;
+                } else {
+                    goto SCANNED;
+                }
+            }
             /* Scan a parameter until its delimiter string has been found; or, if |s=null|,
                simply scan the delimiter string; */
 
@@ -562,6 +611,7 @@ void macro_call(void)
                always fail the test `|cur_tok=info(r)|' in the following algorithm. */
           CONTINUE:
             get_token();        /* set |cur_tok| to the next token of input */
+          SCANNED:
             if (cur_tok == token_info(r)) {
                 /* Advance |r|; |goto found| if the parameter delimiter has been
                    fully matched, otherwise |goto continue| */
@@ -725,6 +775,7 @@ void macro_call(void)
                 } else {
                     pstack[n] = token_link(temp_token_head);
                 }
+              TUCKED:
                 incr(n);
                 if (int_par(tracing_macros_code) > 0) {
                     begin_diagnostic();
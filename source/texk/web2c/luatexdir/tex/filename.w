@@ -108,6 +108,7 @@ static void end_name(void)
 	xfree(cur_string);
         cur_length = (unsigned) strlen((char *) s);
         cur_string = s;
+        cur_string_size = cur_length;
     }
     if (ext_delimiter == 0) {
         cur_name = make_string();
@@ -121,6 +122,7 @@ static void end_name(void)
 	xfree(cur_string);
         cur_length = (unsigned) strlen((char *) s);
         cur_string = s;
+        cur_string_size = cur_length;
         cur_ext = make_string();
     }
 }
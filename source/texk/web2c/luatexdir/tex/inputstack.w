@@ -428,6 +428,42 @@ void begin_token_list(halfword p, quarterword t)
 }
 
 
+@ The parameters of a macro that ends are chained together and handed back
+to the |avail| list in one step, instead of one |flush_list| per parameter.
+Macros that are called millions of times tend to have short arguments, so
+this saves more than it seems.
+
+@c
+static void flush_param_lists(void)
+{
+    halfword h = null;          /* head of the combined list */
+    halfword t = null;          /* its tail */
+    halfword q;
+    int k = 0;                  /* the number of nodes released */
+    while (param_ptr > param_start) {
+        decr(param_ptr);
+        q = param_stack[param_ptr];
+        if (q != null) {
+            if (t == null)
+                h = q;
+            else
+                set_token_link(t, q);
+            while (1) {
+                k++;
+                if (token_link(q) == null)
+                    break;
+                q = token_link(q);
+            }
+            t = q;
+        }
+    }
+    if (t != null) {
+        set_token_link(t, avail);
+        avail = h;
+        dyn_used -= k;
+    }
+}
+
 @ When a token list has been fully scanned, the following computations
 should be done as we leave that level of input. The |token_type| tends
 to be equal to either |backed_up| or |inserted| about 2/3 of the time.
@@ -441,11 +477,9 @@ void end_token_list(void)
             flush_list(istart);
         } else {
             delete_token_ref(istart);   /* update reference count */
-            if (token_type == macro) {  /* parameters must be flushed */
-                while (param_ptr > param_start) {
-                    decr(param_ptr);
-                    flush_list(param_stack[param_ptr]);
-                }
+            if (token_type == macro && param_ptr > param_start) {
+                /* parameters must be flushed */
+                flush_param_lists();
             }
         }
     } else if (token_type == u_template) {
@@ -31,4 +31,9 @@ extern scaled get_math_quad(int a);
 
 extern void mlist_to_hlist_args(halfword, int, boolean);
 
+extern int math_cache_entries;
+extern int math_cache_hits;
+extern int math_cache_misses;
+extern void flush_math_list_cache(void);
+
 #endif
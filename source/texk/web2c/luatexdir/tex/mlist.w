@@ -37,6 +37,8 @@
 #define script_space         dimen_par(script_space_code)
 #define disable_lig          int_par(disable_lig_code)
 #define disable_kern         int_par(disable_kern_code)
+#define text_direction       int_par(text_direction_code)
+#define math_list_cache      int_par(math_list_cache_code)
 
 #define nDEBUG
 
@@ -1539,6 +1541,275 @@ static void math_kern(pointer p, scaled m)
     }
 }
 
+@ When \.{\\mathlistcache} is positive, the hlists of that many formulas are
+kept, so that a formula that occurs again is copied instead of converted
+anew. A formula is identified by a key: a sequence of integers that
+describes the noads, their kernels and attributes, the style, and everything
+outside the list that |mlist_to_hlist| looks at. The families and math
+parameters are represented by |math_data_serial|. Formulas that contain
+boxes, rules, whatsits or other nodes that are not described here are not
+cached. A formula that raised an error is not cached either, but a missing
+character is reported for the first occurrence only.
+
+@c
+#define MATH_CACHE_SIZE 1021    /* the number of hash buckets */
+
+typedef struct math_cache_entry {
+    unsigned hash;
+    int length;                 /* the length of |key| */
+    int *key;
+    halfword list;              /* the converted hlist */
+    struct math_cache_entry *next;
+} math_cache_entry;
+
+static math_cache_entry *math_cache[MATH_CACHE_SIZE];
+int math_cache_entries = 0;
+int math_cache_hits = 0;
+int math_cache_misses = 0;
+
+static int *math_key = NULL;
+static int math_key_size = 0;
+static int math_key_ptr = 0;
+
+static void math_key_add(int v)
+{
+    if (math_key_ptr == math_key_size) {
+        math_key_size = (math_key_size == 0 ? 256 : 2 * math_key_size);
+        math_key = xrealloc(math_key, (unsigned) math_key_size * sizeof(int));
+    }
+    math_key[math_key_ptr++] = v;
+}
+
+static void math_key_attr(halfword a)
+{
+    if (a != null) {
+        for (a = vlink(a); a != null; a = vlink(a)) {
+            math_key_add(attribute_id(a));
+            math_key_add(attribute_value(a));
+        }
+    }
+    math_key_add(-1);
+}
+
+static void math_key_glue(halfword g)
+{
+    math_key_add(width(g));
+    math_key_add(stretch(g));
+    math_key_add(shrink(g));
+    math_key_add(stretch_order(g));
+    math_key_add(shrink_order(g));
+}
+
+static boolean math_key_list(halfword p);
+
+static boolean math_key_kernel(halfword q)
+{
+    if (q == null) {
+        math_key_add(-1);
+        return true;
+    }
+    math_key_add(type(q));
+    math_key_add(subtype(q));
+    math_key_attr(node_attr(q));
+    switch (type(q)) {
+    case math_char_node:
+    case math_text_char_node:
+        math_key_add(math_fam(q));
+        math_key_add(math_character(q));
+        return true;
+    case delim_node:
+        math_key_add(small_fam(q));
+        math_key_add(small_char(q));
+        math_key_add(large_fam(q));
+        math_key_add(large_char(q));
+        return true;
+    case sub_mlist_node:
+        return math_key_list(math_list(q));
+    default:
+        return false;
+    }
+}
+
+static boolean math_key_list(halfword p)
+{
+    while (p != null) {
+        math_key_add(type(p));
+        math_key_add(subtype(p));
+        math_key_attr(node_attr(p));
+        switch (type(p)) {
+        case style_node:
+            break;
+        case choice_node:
+            if (!math_key_list(display_mlist(p)) ||
+                !math_key_list(text_mlist(p)) ||
+                !math_key_list(script_mlist(p)) ||
+                !math_key_list(script_script_mlist(p)))
+                return false;
+            break;
+        case simple_noad:
+        case radical_noad:
+        case accent_noad:
+            if (!math_key_kernel(nucleus(p)) ||
+                !math_key_kernel(subscr(p)) || !math_key_kernel(supscr(p)))
+                return false;
+            if (type(p) == accent_noad) {
+                if (!math_key_kernel(accent_chr(p)) ||
+                    !math_key_kernel(bot_accent_chr(p)))
+                    return false;
+            } else if (type(p) == radical_noad) {
+                if (!math_key_kernel(left_delimiter(p)) ||
+                    !math_key_kernel(degree(p)))
+                    return false;
+            }
+            break;
+        case fence_noad:
+            if (!math_key_kernel(delimiter(p)))
+                return false;
+            break;
+        case fraction_noad:
+            math_key_add(thickness(p));
+            if (!math_key_kernel(numerator(p)) ||
+                !math_key_kernel(denominator(p)) ||
+                !math_key_kernel(left_delimiter(p)) ||
+                !math_key_kernel(right_delimiter(p)))
+                return false;
+            break;
+        case glue_node:
+            if (leader_ptr(p) != null)
+                return false;
+            math_key_glue(glue_ptr(p));
+            break;
+        case kern_node:
+            math_key_add(width(p));
+            break;
+        case penalty_node:
+            math_key_add(penalty(p));
+            break;
+        default:
+            return false;
+        }
+        p = vlink(p);
+    }
+    math_key_add(-2);
+    return true;
+}
+
+static unsigned math_key_hash(void)
+{
+    unsigned h = 2166136261U;
+    int i;
+    for (i = 0; i < math_key_ptr; i++)
+        h = (h ^ (unsigned) math_key[i]) * 16777619U;
+    return h;
+}
+
+@ The cache is emptied when it is full, when \.{\\mathlistcache} is set to
+zero, and before a format is dumped.
+
+@c
+void flush_math_list_cache(void)
+{
+    math_cache_entry *e, *n;
+    int i;
+    for (i = 0; i < MATH_CACHE_SIZE; i++) {
+        for (e = math_cache[i]; e != NULL; e = n) {
+            n = e->next;
+            flush_node_list(e->list);
+            xfree(e->key);
+            xfree(e);
+        }
+        math_cache[i] = NULL;
+    }
+    math_cache_entries = 0;
+}
+
+@ The nodes of a cached list carry the \.{synctex} tag and line of the
+formula it was made for. |copy_node| gives math and kern nodes the current
+ones, as |new_node| would have; the glue, boxes and rules of a copy get
+them here, so that a formula from the cache points to where it is used.
+
+@c
+static void math_cache_synctex(halfword p)
+{
+    for (; p != null; p = vlink(p)) {
+        switch (type(p)) {
+        case glue_node:
+            synctex_tag_glue(p) = cur_input.synctex_tag_field;
+            synctex_line_glue(p) = line;
+            break;
+        case hlist_node:
+        case vlist_node:
+            synctex_tag_box(p) = cur_input.synctex_tag_field;
+            synctex_line_box(p) = line;
+            math_cache_synctex(list_ptr(p));
+            break;
+        case rule_node:
+            synctex_tag_rule(p) = cur_input.synctex_tag_field;
+            synctex_line_rule(p) = line;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void cached_mlist_to_hlist(halfword p, int mstyle, boolean penalties)
+{
+    math_cache_entry *e;
+    unsigned h;
+    int errors = error_count;
+    int hist = history;
+    math_key_ptr = 0;
+    math_key_add(mstyle);
+    math_key_add(penalties);
+    math_key_add(math_data_serial);
+    math_key_add(delimiter_factor);
+    math_key_add(delimiter_shortfall);
+    math_key_add(bin_op_penalty);
+    math_key_add(rel_penalty);
+    math_key_add(null_delimiter_space);
+    math_key_add(script_space);
+    math_key_add(disable_lig);
+    math_key_add(disable_kern);
+    math_key_add(text_direction);
+    math_key_glue(glue_par(thin_mu_skip_code));
+    math_key_glue(glue_par(med_mu_skip_code));
+    math_key_glue(glue_par(thick_mu_skip_code));
+    math_key_attr(current_attribute_list());
+    if (!math_key_list(p)) {
+        math_cache_misses++;
+        mlist_to_hlist_args(p, mstyle, penalties);
+        return;
+    }
+    h = math_key_hash();
+    for (e = math_cache[h % MATH_CACHE_SIZE]; e != NULL; e = e->next) {
+        if (e->hash == h && e->length == math_key_ptr &&
+            memcmp(e->key, math_key, (size_t) math_key_ptr * sizeof(int)) == 0) {
+            math_cache_hits++;
+            flush_node_list(p);
+            p = copy_node_list(e->list);        /* this can move |varmem| */
+            math_cache_synctex(p);
+            vlink(temp_head) = p;
+            return;
+        }
+    }
+    math_cache_misses++;
+    mlist_to_hlist_args(p, mstyle, penalties);
+    if (error_count != errors || history != hist)
+        return;
+    if (math_cache_entries >= math_list_cache)
+        flush_math_list_cache();
+    e = xmalloc(sizeof(math_cache_entry));
+    e->hash = h;
+    e->length = math_key_ptr;
+    e->key = xmalloc((unsigned) math_key_ptr * sizeof(int));
+    memcpy(e->key, math_key, (size_t) math_key_ptr * sizeof(int));
+    e->list = copy_node_list(vlink(temp_head));
+    e->next = math_cache[h % MATH_CACHE_SIZE];
+    math_cache[h % MATH_CACHE_SIZE] = e;
+    math_cache_entries++;
+}
+
 @ @c
 void run_mlist_to_hlist(halfword p, int mstyle, boolean penalties)
 {
@@ -1572,7 +1843,13 @@ void run_mlist_to_hlist(halfword p, int mstyle, boolean penalties)
         lua_settop(L, sfix);
         vlink(temp_head) = a;
     } else if (callback_id == 0) {
-        mlist_to_hlist_args(p, mstyle, penalties);
+        if (math_list_cache > 0) {
+            cached_mlist_to_hlist(p, mstyle, penalties);
+        } else {
+            if (math_cache_entries > 0)
+                flush_math_list_cache();
+            mlist_to_hlist_args(p, mstyle, penalties);
+        }
     } else {
         vlink(temp_head) = null;
     }
@@ -70,6 +70,8 @@ extern halfword filtered_hpack(halfword p, halfword qt, scaled w, int m,
 
 extern scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
                                 int g_sign, int g_order, int d);
+extern scaled_whd natural_totals(halfword p, halfword pp, int d,
+                                 scaled * stretch_t, scaled * shrink_t);
 
 extern int pack_begin_line;
 
@@ -93,6 +95,9 @@ extern scaled best_height_plus_depth;   /* height of the best box, without stret
 
 extern halfword vert_break(halfword p, scaled h, scaled d);
 extern halfword vsplit(halfword n, scaled h);   /* extracts a page of height |h| from box |n| */
+extern int page_breaks(halfword p, scaled * heights, int nheights,
+                       halfword topskip, scaled d, int page_penalty,
+                       halfword ** breaks, int *nbreaks, double *demerits);
 
 #  define box_code 0            /* |chr_code| for `\.{\\box}' */
 #  define copy_code 1           /* |chr_code| for `\.{\\copy}' */
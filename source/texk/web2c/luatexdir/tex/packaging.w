@@ -458,6 +458,21 @@ halfword hpack(halfword p, scaled w, int m, int pack_direction)
         /* Examine node |p| in the hlist, taking account of its effect
            on the dimensions of the new box, or moving it to the adjustment list;
            then advance |p| to the next node */
+        if (m < cal_expand_ratio && (hpack_dir == dir_TLT || hpack_dir == dir_TRT)) {
+            /* The usual case: horizontal text and no font expansion to take
+               care of, so the dimensions come straight from the font. */
+            while (is_char_node(p)) {
+                whd = glyph_dimensions(p);
+                if (ex_glyph(p) != 0)
+                    whd.wd = ext_xn_over_d(whd.wd, 1000000 + ex_glyph(p), 1000000);
+                x += whd.wd;
+                if (whd.ht > h)
+                    h = whd.ht;
+                if (whd.dp > d)
+                    d = whd.dp;
+                p = vlink(p);
+            }
+        }
         while (is_char_node(p)) {
             /* Incorporate character dimensions into the dimensions of
                the hbox that will contain~it, then move to the next node */
@@ -824,25 +839,29 @@ halfword filtered_hpack(halfword p, halfword qt, scaled w, int m, int grp,
     return hpack(q, w, m, pac);
 }
 
-@ here is a function to calculate the natural whd of a (horizontal) node list
+@ here is a function to calculate the natural whd of a (horizontal) node list.
+When |stretch_t| is not |NULL|, the glue stretch and shrink are added to
+|stretch_t| and |shrink_t| per order, like |hpack| does in |total_stretch|
+and |total_shrink|.
 
 @c
-scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
-                         int g_sign, int g_order, int pack_direction)
+static scaled_whd measure_hlist(halfword p, halfword pp, glue_ratio g_mult,
+                                int g_sign, int g_order, int hpack_dir,
+                                scaled * stretch_t, scaled * shrink_t)
 {
     scaled s;                   /* shift amount */
     halfword g;                 /* points to a glue specification */
-    int hpack_dir;
     scaled_whd xx;              /* for recursion */
     scaled_whd whd, siz = { 0, 0, 0 };
-    if (pack_direction == -1) {
-        hpack_dir = text_direction;
-    } else {
-        hpack_dir = pack_direction;
-    }
     while (p != pp && p != null) {
         while (is_char_node(p) && p != pp) {
-            whd = pack_width_height_depth(hpack_dir, dir_TRT, p, true);
+            if (hpack_dir == dir_TLT || hpack_dir == dir_TRT) {
+                whd = glyph_dimensions(p);
+                if (ex_glyph(p) != 0)
+                    whd.wd = ext_xn_over_d(whd.wd, 1000000 + ex_glyph(p), 1000000);
+            } else {
+                whd = pack_width_height_depth(hpack_dir, dir_TRT, p, true);
+            }
             siz.wd += whd.wd;
             if (whd.ht > siz.ht)
                 siz.ht = whd.ht;
@@ -888,6 +907,10 @@ scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
             case glue_node:
                 g = glue_ptr(p);
                 siz.wd += width(g);
+                if (stretch_t != NULL) {
+                    stretch_t[stretch_order(g)] += stretch(g);
+                    shrink_t[shrink_order(g)] += shrink(g);
+                }
                 if (g_sign != normal) {
                     if (g_sign == stretching) {
                         if (stretch_order(g) == g_order) {
@@ -917,8 +940,8 @@ scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
                 siz.wd += surround(p);
                 break;
             case disc_node:
-                xx = natural_sizes(no_break(p), null, g_mult, g_sign, g_order,
-                                   hpack_dir);
+                xx = measure_hlist(no_break(p), null, g_mult, g_sign, g_order,
+                                   hpack_dir, stretch_t, shrink_t);
                 siz.wd += xx.wd;
                 if (xx.ht > siz.ht)
                     siz.ht = xx.ht;
@@ -935,6 +958,34 @@ scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
     return siz;
 }
 
+scaled_whd natural_sizes(halfword p, halfword pp, glue_ratio g_mult,
+                         int g_sign, int g_order, int pack_direction)
+{
+    if (pack_direction == -1)
+        pack_direction = text_direction;
+    return measure_hlist(p, pp, g_mult, g_sign, g_order, pack_direction,
+                         NULL, NULL);
+}
+
+@ |natural_totals| measures a list in one pass for |node.direct.measure|:
+the natural dimensions, and in |stretch_t| and |shrink_t| the glue totals
+per order, which have room for |filll+1| values.
+
+@c
+scaled_whd natural_totals(halfword p, halfword pp, int pack_direction,
+                          scaled * stretch_t, scaled * shrink_t)
+{
+    int o;
+    for (o = normal; o <= filll; o++) {
+        stretch_t[o] = 0;
+        shrink_t[o] = 0;
+    }
+    if (pack_direction == -1)
+        pack_direction = text_direction;
+    return measure_hlist(p, pp, 0.0, normal, normal, pack_direction,
+                         stretch_t, shrink_t);
+}
+
 
 @ In order to provide a decent indication of where an overfull or underfull
 box originated, we use a global variable |pack_begin_line| that is
@@ -1560,6 +1611,407 @@ halfword vert_break(halfword p, scaled h, scaled d)
 }
 
 
+@ |vert_break| is greedy: it fills one page at a time. |page_breaks| finds the
+breaks for a whole vertical list at once, the way |line_break| treats a
+paragraph: it minimizes the sum of the page demerits, and it returns the
+chosen breakpoints without changing the list. It is only called from
+\LUA\ (|tex.pagebreak|).
+
+The demerits of a page are those of a line in |line_break|: the per-page
+constant |page_penalty| is added to the badness of the page and squared,
+and the square of the penalty at its end is added (or subtracted, when the
+penalty is negative but not forced). Every page thus costs something, and
+glue that can stretch infinitely does not lead to a break after every box.
+
+The legal breakpoints are those of |vert_break|, and the list ends with
+a forced break. Every page starts with the first box or rule after its
+breakpoint, as |prune_page_top| would leave it, preceded by |topskip|
+glue. Page~$k$ has height |heights[k-1]|, and the last of the |nheights|
+values is used for all following pages. An insertion takes the room of
+its natural height; marks take none.
+
+A first pass records, for every breakpoint, the height and glue totals from
+the start of the list (|page_candidate|). The second pass keeps the active
+breakpoints in a list of |page_active| records, which come from a pool
+with a free list, so that dropped records are reused.
+
+@c
+typedef struct {
+    halfword node;              /* the breakpoint, or |null| for the end of the list */
+    int pi;                     /* its penalty */
+    scaled height;              /* the height from the start of the list */
+    scaled stretch[5];          /* the stretch per order */
+    scaled shrink;
+    boolean has_start;          /* there is a box after the break */
+    scaled start_height;        /* the height at the start of the next page */
+    scaled start_stretch[5];
+    scaled start_shrink;
+} page_candidate;
+
+typedef struct {
+    int candidate;              /* where the page before it ends */
+    int pages;                  /* the number of pages up to here */
+    int passive;                /* the chain of earlier breaks */
+    int next;                   /* the next active, or $-1$ */
+    double demerits;            /* the total cost up to here */
+} page_active;
+
+typedef struct {
+    int candidate;
+    int prev;
+} page_passive;
+
+@ The first pass. The heights follow |vert_break|, including the
+treatment of the depth of the last box and of |max_depth|. The
+|start_| fields of a breakpoint are filled in when the first box
+after it is seen; the virtual breakpoint at index 0 stands for the
+start of the list.
+
+@c
+static page_candidate *page_candidates(halfword p, halfword topskip,
+                                       scaled d, int *n)
+{
+    int size = 64, count = 1, pending = 0, i, o;
+    page_candidate *c = xmalloc((unsigned) size * sizeof(page_candidate));
+    halfword prev_p = p, q;
+    scaled height = 0, prev_dp = 0, shrink = 0;
+    scaled stretch[5] = { 0, 0, 0, 0, 0 };
+    int pi, t;
+    memset(&c[0], 0, sizeof(page_candidate));
+    while (1) {
+        if (p == null) {
+            pi = eject_penalty;
+        } else {
+            switch (type(p)) {
+            case hlist_node:
+            case vlist_node:
+            case rule_node:
+                height = height + prev_dp + height(p);
+                prev_dp = depth(p);
+                /* the page after a pending breakpoint starts here, with
+                   |topskip| instead of whatever preceded this box */
+                for (i = pending; i < count; i++) {
+                    c[i].has_start = true;
+                    c[i].start_height = height -
+                        (height(p) > width(topskip) ? height(p) : width(topskip));
+                    for (o = normal; o <= filll; o++)
+                        c[i].start_stretch[o] = stretch[o];
+                    c[i].start_stretch[stretch_order(topskip)] -= stretch(topskip);
+                    c[i].start_shrink = shrink - shrink(topskip);
+                }
+                pending = count;
+                goto NOT_FOUND;
+            case whatsit_node:
+                if ((subtype(p) == pdf_refxform_node)
+                    || (subtype(p) == pdf_refximage_node)) {
+                    height = height + prev_dp + height(p);
+                    prev_dp = depth(p);
+                }
+                goto NOT_FOUND;
+            case glue_node:
+                if (precedes_break(prev_p))
+                    pi = 0;
+                else
+                    goto UPDATE_HEIGHTS;
+                break;
+            case kern_node:
+                if (vlink(p) == null)
+                    t = penalty_node;
+                else
+                    t = type(vlink(p));
+                if (t == glue_node)
+                    pi = 0;
+                else
+                    goto UPDATE_HEIGHTS;
+                break;
+            case penalty_node:
+                pi = penalty(p);
+                break;
+            case ins_node:
+                height = height + height(p);
+                goto NOT_FOUND;
+            default:
+                goto NOT_FOUND;
+            }
+        }
+        if (pi < inf_penalty) {
+            if (count == size) {
+                size += size;
+                c = xrealloc(c, (unsigned) size * sizeof(page_candidate));
+            }
+            c[count].node = p;
+            c[count].pi = pi;
+            c[count].height = height;
+            for (o = normal; o <= filll; o++)
+                c[count].stretch[o] = stretch[o];
+            c[count].shrink = shrink;
+            c[count].has_start = false;
+            count++;
+            if (p == null)
+                break;
+        }
+        if ((type(p) < glue_node) || (type(p) > kern_node))
+            goto NOT_FOUND;
+      UPDATE_HEIGHTS:
+        if (type(p) == kern_node) {
+            q = p;
+        } else {
+            q = glue_ptr(p);
+            stretch[stretch_order(q)] += stretch(q);
+            shrink += shrink(q);        /* infinite shrink is taken as finite */
+        }
+        height = height + prev_dp + width(q);
+        prev_dp = 0;
+      NOT_FOUND:
+        if (prev_dp > d) {
+            height = height + prev_dp - d;
+            prev_dp = d;
+        }
+        prev_p = p;
+        p = vlink(prev_p);
+    }
+    *n = count;
+    return c;
+}
+
+@ The badness of the page from breakpoint |a| to breakpoint |b|, or
+|awful_bad| when it is too full. As in |vert_break|, a page that ends
+at a forced break is not underfull, and one that can not stretch enough
+is |deplorable|.
+
+@c
+static int page_cost(page_candidate * a, page_candidate * b, scaled h)
+{
+    scaled x = b->height - a->start_height;
+    scaled shrink = b->shrink - a->start_shrink;
+    scaled s[5];
+    int o, bad;
+    for (o = normal; o <= filll; o++)
+        s[o] = b->stretch[o] - a->start_stretch[o];
+    if (x < h) {
+        if (s[sfi] != 0 || s[fil] != 0 || s[fill] != 0 || s[filll] != 0)
+            bad = 0;
+        else
+            bad = badness(h - x, s[normal]);
+    } else if (x - h > shrink) {
+        return awful_bad;
+    } else {
+        bad = badness(x - h, shrink);
+    }
+    if (b->pi <= eject_penalty)
+        return 0;
+    else if (bad < inf_bad)
+        return bad;
+    else
+        return deplorable;
+}
+
+static double page_demerits(int bad, int pi, int page_penalty)
+{
+    double d = (double) page_penalty + (double) bad;
+    d = d * d;
+    if (pi > 0)
+        d = d + (double) pi * (double) pi;
+    else if (pi > eject_penalty)
+        d = d - (double) pi * (double) pi;
+    return d;
+}
+@ The second pass. For every breakpoint all active breakpoints are tried.
+An active breakpoint is dropped when the page after it gets too full, and
+at a forced break all of them are dropped. If that leaves no page at all,
+the page from the best dropped one is taken although it is overfull, so
+there is always a solution. Of the new breaks only the best one per page
+height class is kept, i.e., per page number up to |nheights|; of equal
+ones the break with fewer pages before it wins. An active breakpoint with no
+box after it can only be followed by the end of the list.
+
+The result is the number of pages; |*breaks| gets the |*nbreaks| chosen
+breakpoints, the end of the list excluded, and |*demerits| the total cost.
+
+@c
+#define page_class(k) ((k) < nheights ? (k) : nheights)
+
+static int new_page_active(page_active ** pool, int *pool_size, int *free_list)
+{
+    int a, i;
+    if (*free_list < 0) {
+        *pool = xrealloc(*pool, (unsigned) (2 * *pool_size) * sizeof(page_active));
+        for (i = *pool_size; i < 2 * *pool_size; i++)
+            (*pool)[i].next = i + 1;
+        (*pool)[2 * *pool_size - 1].next = -1;
+        *free_list = *pool_size;
+        *pool_size *= 2;
+    }
+    a = *free_list;
+    *free_list = (*pool)[a].next;
+    return a;
+}
+
+int page_breaks(halfword p, scaled * heights, int nheights, halfword topskip,
+                scaled d, int page_penalty, halfword ** breaks, int *nbreaks,
+                double *demerits)
+{
+    int n, b, a, prev_a, next, k, bad;
+    double cost;
+    int pool_size = 16, free_list, actives;
+    int npassive = 0, spassive = 64;
+    boolean done = false;
+    int pages = 0, chain = -1;
+    boolean dropped;
+    int dropped_pages = 0, dropped_passive = -1;
+    double dropped_demerits = 0.0, total = 0.0;
+    page_candidate *c;
+    page_active *pool, *r;
+    page_passive *passive;
+    double *best_demerits;
+    int *best_passive, *best_pages;
+
+    c = page_candidates(p, topskip, d, &n);
+    pool = xmalloc((unsigned) pool_size * sizeof(page_active));
+    for (a = 0; a < pool_size; a++)
+        pool[a].next = a + 1;
+    pool[pool_size - 1].next = -1;
+    free_list = 0;
+    passive = xmalloc((unsigned) spassive * sizeof(page_passive));
+    best_demerits = xmalloc((unsigned) (nheights + 1) * sizeof(double));
+    best_passive = xmalloc((unsigned) (nheights + 1) * sizeof(int));
+    best_pages = xmalloc((unsigned) (nheights + 1) * sizeof(int));
+
+    /* the start of the list is the first active breakpoint */
+    actives = new_page_active(&pool, &pool_size, &free_list);
+    pool[actives].candidate = 0;
+    pool[actives].pages = 0;
+    pool[actives].passive = -1;
+    pool[actives].demerits = 0.0;
+    pool[actives].next = -1;
+
+    for (b = 1; b < n; b++) {
+        for (k = 1; k <= nheights; k++)
+            best_pages[k] = 0;
+        dropped = false;
+        prev_a = -1;
+        for (a = actives; a >= 0; a = next) {
+            r = &pool[a];
+            next = r->next;
+            if (!c[r->candidate].has_start) {
+                if (c[b].node == null && (!done || r->demerits < total
+                                          || (r->demerits == total && r->pages < pages))) {
+                    done = true;
+                    total = r->demerits;
+                    chain = r->passive;
+                    pages = r->pages;
+                }
+                prev_a = a;
+                continue;
+            }
+            bad = page_cost(&c[r->candidate], &c[b],
+                            heights[page_class(r->pages + 1) - 1]);
+            if (bad == awful_bad) {
+                if (!dropped || r->demerits < dropped_demerits) {
+                    dropped = true;
+                    dropped_demerits = r->demerits;
+                    dropped_passive = r->passive;
+                    dropped_pages = r->pages;
+                }
+                if (prev_a < 0)
+                    actives = next;
+                else
+                    pool[prev_a].next = next;
+                r->next = free_list;
+                free_list = a;
+                continue;
+            }
+            cost = r->demerits + page_demerits(bad, c[b].pi, page_penalty);
+            k = page_class(r->pages + 1);
+            if (!best_pages[k] || cost < best_demerits[k]
+                || (cost == best_demerits[k] && r->pages + 1 < best_pages[k])) {
+                best_pages[k] = r->pages + 1;
+                best_demerits[k] = cost;
+                best_passive[k] = r->passive;
+            }
+            prev_a = a;
+        }
+        if (dropped) {
+            for (k = 1; k <= nheights; k++)
+                if (best_pages[k])
+                    break;
+            if (k > nheights) {
+                /* an overfull page can not be avoided */
+                k = page_class(dropped_pages + 1);
+                best_pages[k] = dropped_pages + 1;
+                best_demerits[k] = dropped_demerits
+                    + page_demerits(awful_bad, c[b].pi, page_penalty);
+                best_passive[k] = dropped_passive;
+            }
+        }
+        if (c[b].node == null) {
+            for (k = 1; k <= nheights; k++) {
+                if (best_pages[k] && (!done || best_demerits[k] < total
+                                      || (best_demerits[k] == total
+                                          && best_pages[k] < pages))) {
+                    done = true;
+                    total = best_demerits[k];
+                    chain = best_passive[k];
+                    pages = best_pages[k];
+                }
+            }
+            break;
+        }
+        if (c[b].pi <= eject_penalty) {
+            /* no page goes past a forced break */
+            prev_a = -1;
+            for (a = actives; a >= 0; a = next) {
+                next = pool[a].next;
+                if (c[pool[a].candidate].has_start) {
+                    if (prev_a < 0)
+                        actives = next;
+                    else
+                        pool[prev_a].next = next;
+                    pool[a].next = free_list;
+                    free_list = a;
+                } else {
+                    prev_a = a;
+                }
+            }
+        }
+        for (k = 1; k <= nheights; k++) {
+            if (best_pages[k]) {
+                if (npassive == spassive) {
+                    spassive += spassive;
+                    passive = xrealloc(passive,
+                                       (unsigned) spassive * sizeof(page_passive));
+                }
+                passive[npassive].candidate = b;
+                passive[npassive].prev = best_passive[k];
+                a = new_page_active(&pool, &pool_size, &free_list);
+                pool[a].candidate = b;
+                pool[a].pages = best_pages[k];
+                pool[a].passive = npassive++;
+                pool[a].demerits = best_demerits[k];
+                pool[a].next = actives;
+                actives = a;
+            }
+        }
+    }
+
+    /* Walk back along the chosen breaks */
+    *nbreaks = 0;
+    for (a = chain; a >= 0; a = passive[a].prev)
+        (*nbreaks)++;
+    *breaks = xmalloc((unsigned) (*nbreaks + 1) * sizeof(halfword));
+    k = *nbreaks;
+    for (a = chain; a >= 0; a = passive[a].prev)
+        (*breaks)[--k] = c[passive[a].candidate].node;
+    *demerits = total;
+    xfree(best_pages);
+    xfree(best_passive);
+    xfree(best_demerits);
+    xfree(passive);
+    xfree(pool);
+    xfree(c);
+    return pages;
+}
+
 @ Now we are ready to consider |vsplit| itself. Most of
 its work is accomplished by the two subroutines that we have just considered.
 
@@ -89,5 +89,10 @@ extern void print_cmd_chr(quarterword cmd, halfword chr_code);
 
 extern pointer string_lookup(const char *s, size_t l);
 extern pointer id_lookup(int j, int l);
+extern void rebuild_cs_index(void);
+extern int get_cs_index_size(void);
+extern double cs_lookups;
+extern double cs_probes;
+extern int cs_max_probes;
 
 #endif                          /* LUATEX_PRIMITIVE_H */
@@ -393,6 +393,164 @@ static halfword insert_id(halfword p, const unsigned char *j, unsigned int l)
 }
 
 
+@ The coalesced lists above are what ends up in the format file, but walking
+them gets slow once a macro package has defined a few hundred thousand
+control sequences: the lists are only |hash_prime| heads wide, and all entries
+that live above |eqtb_size| hang off a single list. Lookups therefore go
+through a separate open-addressed index over the same hash locations. It
+hashes the name a word at a time, probes linearly and doubles in size when
+it gets half full. The index is never dumped; |rebuild_cs_index| recreates
+it after the hash has been undumped, so the format stays as it was.
+
+@c
+static halfword *cs_index = NULL;       /* hash locations, |0| if empty */
+static unsigned int *cs_index_hash = NULL;      /* full hash codes of the entries */
+static unsigned int cs_index_size = 0;  /* a power of two */
+static unsigned int cs_index_used = 0;  /* occupied slots */
+
+double cs_lookups = 0;                  /* calls to |id_lookup| and |string_lookup| */
+double cs_probes = 0;                   /* slots inspected by those calls */
+int cs_max_probes = 0;                  /* longest probe sequence seen */
+
+#define cs_index_min_size 65536
+
+#define cs_mix(h) do {                          \
+        h *= 0xBF58476D1CE4E5B9ULL;             \
+        h ^= h >> 31;                           \
+    } while (0)
+
+static unsigned int cs_hash(const unsigned char *s, size_t l)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t) l;
+    uint64_t w;
+    while (l >= 8) {
+        memcpy(&w, s, 8);
+        h ^= w;
+        cs_mix(h);
+        s += 8;
+        l -= 8;
+    }
+    if (l > 0) {
+        w = 0;
+        memcpy(&w, s, l);
+        h ^= w;
+        cs_mix(h);
+    }
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 29;
+    return (unsigned int) h;
+}
+
+static void cs_index_store(halfword p, unsigned int h)
+{
+    unsigned int mask = cs_index_size - 1;
+    unsigned int i = h & mask;
+    while (cs_index[i] != 0)
+        i = (i + 1) & mask;
+    cs_index[i] = p;
+    cs_index_hash[i] = h;
+    cs_index_used++;
+}
+
+static void cs_index_resize(unsigned int size)
+{
+    halfword *old_index = cs_index;
+    unsigned int *old_hash = cs_index_hash;
+    unsigned int old_size = cs_index_size;
+    unsigned int i;
+    cs_index = xcalloc(size, sizeof(halfword));
+    cs_index_hash = xmalloc(size * sizeof(unsigned int));
+    cs_index_size = size;
+    cs_index_used = 0;
+    for (i = 0; i < old_size; i++) {
+        if (old_index[i] != 0)
+            cs_index_store(old_index[i], old_hash[i]);
+    }
+    xfree(old_index);
+    xfree(old_hash);
+}
+
+static void cs_index_add(halfword p, unsigned int h)
+{
+    if (2 * (cs_index_used + 1) > cs_index_size)
+        cs_index_resize(cs_index_size == 0 ? cs_index_min_size : 2 * cs_index_size);
+    cs_index_store(p, h);
+}
+
+@ The lookup returns |0| when the name is not known yet.
+
+@c
+static halfword cs_index_find(const unsigned char *s, size_t l, unsigned int h)
+{
+    unsigned int mask = cs_index_size - 1;
+    unsigned int i = h & mask;
+    int n = 0;
+    halfword p = 0;
+    cs_lookups++;
+    if (cs_index_size == 0)
+        return 0;
+    while (cs_index[i] != 0) {
+        n++;
+        if (cs_index_hash[i] == h) {
+            str_number t = cs_text(cs_index[i]);
+            if (str_length(t) == l && memcmp(str_string(t), s, l) == 0) {
+                p = cs_index[i];
+                break;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+    cs_probes += n;
+    if (n > cs_max_probes)
+        cs_max_probes = n;
+    return p;
+}
+
+@ New names still go to the end of their coalesced list, exactly as before,
+so that dumped formats do not depend on the index.
+
+@c
+static halfword cs_insert(const unsigned char *s, size_t l, unsigned int h)
+{
+    pointer p = compute_hash((const char *) s, (unsigned) l, hash_prime) + hash_base;
+    while (cs_next(p) != 0)
+        p = cs_next(p);
+    p = insert_id(p, s, (unsigned) l);
+    cs_index_add(p, h);
+    return p;
+}
+
+@ All multiletter names live either in the |hash_size| locations starting at
+|hash_base| or in the |hash_extra| ones above |eqtb_size|; the frozen control
+sequences and font identifiers are not reachable by name and stay out.
+
+@c
+void rebuild_cs_index(void)
+{
+    halfword p;
+    unsigned int size = cs_index_min_size;
+    xfree(cs_index);
+    xfree(cs_index_hash);
+    cs_index_size = 0;
+    cs_index_used = 0;
+    while (size < 2 * (unsigned) (cs_count + 1))
+        size *= 2;
+    cs_index_resize(size);
+    for (p = hash_base; p < frozen_control_sequence; p++) {
+        if (cs_text(p) > 0)
+            cs_index_store(p, cs_hash(str_string(cs_text(p)), str_length(cs_text(p))));
+    }
+    for (p = eqtb_size + 1; p <= eqtb_size + hash_high; p++) {
+        if (cs_text(p) > 0)
+            cs_index_store(p, cs_hash(str_string(cs_text(p)), str_length(cs_text(p))));
+    }
+}
+
+int get_cs_index_size(void)
+{
+    return (int) cs_index_size;
+}
+
 @ Here is the subroutine that searches the hash table for an identifier
  that matches a given string of length |l>1| appearing in |buffer[j..
  (j+l-1)]|. If the identifier is found, the corresponding hash table address
@@ -404,10 +562,10 @@ static halfword insert_id(halfword p, const unsigned char *j, unsigned int l)
 @c
 pointer id_lookup(int j, int l)
 {                               /* search the hash table */
-    int h;                      /* hash code */
+    unsigned int h;             /* hash code */
     pointer p;                  /* index in |hash| array */
 
-    h = compute_hash((char *) (buffer + j), (unsigned) l, hash_prime);
+    h = cs_hash(buffer + j, (size_t) l);
 #ifdef VERBOSE
     {
         unsigned char *todo = xmalloc(l + 2);
@@ -418,23 +576,13 @@ pointer id_lookup(int j, int l)
         free(todo);
     }
 #endif
-    p = h + hash_base;          /* we start searching here; note that |0<=h<hash_prime| */
-    while (1) {
-        if (cs_text(p) > 0)
-            if (str_length(cs_text(p)) == (unsigned) l)
-                if (str_eq_buf(cs_text(p), j))
-                    goto FOUND;
-        if (cs_next(p) == 0) {
-            if (no_new_control_sequence) {
-                p = undefined_control_sequence;
-            } else {
-                p = insert_id(p, (buffer + j), (unsigned) l);
-            }
-            goto FOUND;
-        }
-        p = cs_next(p);
+    p = cs_index_find(buffer + j, (size_t) l, h);
+    if (p == 0) {
+        if (no_new_control_sequence)
+            p = undefined_control_sequence;
+        else
+            p = cs_insert(buffer + j, (size_t) l, h);
     }
-  FOUND:
     return p;
 }
 
@@ -444,28 +592,20 @@ This one is based on a C string.
 @c
 pointer string_lookup(const char *s, size_t l)
 {                               /* search the hash table */
-    int h;                      /* hash code */
+    unsigned int h;             /* hash code */
     pointer p;                  /* index in |hash| array */
-    h = compute_hash(s, (unsigned) l, hash_prime);
-    p = h + hash_base;          /* we start searching here; note that |0<=h<hash_prime| */
-    while (1) {
-        if (cs_text(p) > 0)
-            if (str_eq_cstr(cs_text(p), s, l))
-                goto FOUND;
-        if (cs_next(p) == 0) {
-            if (no_new_control_sequence) {
-                p = undefined_control_sequence;
-            } else {
-                p = insert_id(p, (const unsigned char *) s, (unsigned) l);
-            }
-            goto FOUND;
-        }
-        p = cs_next(p);
+    h = cs_hash((const unsigned char *) s, l);
+    p = cs_index_find((const unsigned char *) s, l, h);
+    if (p == 0) {
+        if (no_new_control_sequence)
+            p = undefined_control_sequence;
+        else
+            p = cs_insert((const unsigned char *) s, l, h);
     }
-  FOUND:
     return p;
 }
 
+
 @ The |print_cmd_chr| routine prints a symbolic interpretation of a
    command code and its modifier. This is used in certain `\.{You can\'t}'
    error messages, and in the implementation of diagnostic routines like
@@ -57,6 +57,139 @@ unsigned cur_length;            /* current index in that buffer */
 unsigned cur_string_size;       /*  malloced size of |cur_string| */
 unsigned pool_size;             /* occupied byte count */
 
+@ The bytes of the strings themselves are not allocated one by one. They are
+carved out of large chunks, and since most strings that get flushed again
+are the ones made last (file names, \.{\csname} and \.{\special} texts,
+strings passed in from \LUA), flushing the newest string simply gives its
+bytes back to the current chunk. A string that is flushed out of order keeps
+its bytes until the whole pool is discarded.
+
+@c
+typedef struct pool_chunk {
+    struct pool_chunk *prev;    /* the chunk that was filled before this one */
+    unsigned char *data;
+    size_t size;
+    size_t used;
+} pool_chunk;
+
+static pool_chunk *pool_chunks = NULL;  /* the chunk that gets new strings */
+
+#define POOL_CHUNK_SIZE 65536
+
+static pool_chunk *new_pool_chunk(size_t size)
+{
+    pool_chunk *c = xmalloc(sizeof(pool_chunk));
+    c->data = xmallocarray(unsigned char, size);
+    c->size = size;
+    c->used = 0;
+    c->prev = pool_chunks;
+    pool_chunks = c;
+    return c;
+}
+
+static unsigned char *pool_alloc(size_t l)
+{
+    pool_chunk *c = pool_chunks;
+    unsigned char *s;
+    if (c == NULL || c->size - c->used < l)
+        c = new_pool_chunk(l > POOL_CHUNK_SIZE ? l : POOL_CHUNK_SIZE);
+    s = c->data + c->used;
+    c->used += l;
+    return s;
+}
+
+static void pool_release(unsigned char *s, size_t l)
+{
+    pool_chunk *c = pool_chunks;
+    if (c != NULL && s + l == c->data + c->used) {
+        c->used -= l;
+        if (c->used == 0 && c->prev != NULL) {
+            pool_chunks = c->prev;
+            xfree(c->data);
+            xfree(c);
+        }
+    }
+}
+
+static void free_pool_chunks(void)
+{
+    while (pool_chunks != NULL) {
+        pool_chunk *c = pool_chunks;
+        pool_chunks = c->prev;
+        xfree(c->data);
+        xfree(c);
+    }
+}
+
+@ Made strings are also entered in a chained hash index, so that
+|search_string| does not have to compare against every string in the pool.
+New strings go to the front of their bucket, which makes the first match the
+newest one, just like the backward scan used to find it. Empty strings are
+not indexed.
+
+@c
+static str_number *str_buckets = NULL;  /* heads of the chains, |0| if empty */
+static str_number *str_chain = NULL;    /* next string in the same bucket */
+static unsigned str_buckets_size = 0;   /* a power of two */
+static unsigned str_indexed = 0;        /* number of strings in the index */
+
+#define str_next(a) str_chain[(a)-STRING_OFFSET]
+
+static unsigned str_hash(const unsigned char *s, size_t l)
+{
+    unsigned h = 2166136261U;
+    while (l-- > 0) {
+        h ^= *s++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static void str_index_resize(unsigned size)
+{
+    str_number s;
+    xfree(str_buckets);
+    str_buckets = xcalloc(size, sizeof(str_number));
+    str_buckets_size = size;
+    for (s = STRING_OFFSET + 1; s < str_ptr; s++) {
+        if (str_string(s) != NULL && str_length(s) > 0) {
+            unsigned h = str_hash(str_string(s), str_length(s)) & (size - 1);
+            str_next(s) = str_buckets[h];
+            str_buckets[h] = s;
+        }
+    }
+}
+
+static void str_index_add(str_number s)
+{
+    unsigned h;
+    if (str_length(s) == 0)
+        return;
+    if (++str_indexed > str_buckets_size) {
+        /* |s| is not below |str_ptr| yet, so it is not picked up here */
+        str_index_resize(str_buckets_size == 0 ? 16384 : 2 * str_buckets_size);
+    }
+    h = str_hash(str_string(s), str_length(s)) & (str_buckets_size - 1);
+    str_next(s) = str_buckets[h];
+    str_buckets[h] = s;
+}
+
+static void str_index_remove(str_number s)
+{
+    str_number *t;
+    if (str_length(s) == 0)
+        return;
+    t = &str_buckets[str_hash(str_string(s), str_length(s)) & (str_buckets_size - 1)];
+    while (*t != 0) {
+        if (*t == s) {
+            *t = str_next(s);
+            str_indexed--;
+            return;
+        }
+        t = &str_next(*t);
+    }
+}
+
 
 @ Once a sequence of characters has been appended to |cur_string|, it
 officially becomes a string when the function |make_string| is called.
@@ -72,7 +205,7 @@ void reset_cur_string(void)
     memset(cur_string, 0, 256);
 }
 
-@  current string enters the pool 
+@  current string enters the pool; the buffer |cur_string| stays for the next one 
 @c
 str_number make_string(void)
 {
@@ -80,11 +213,14 @@ str_number make_string(void)
         overflow("number of strings",
                  (unsigned) (max_strings - init_str_ptr + STRING_OFFSET));
     str_room(1);
-    cur_string[cur_length] = '\0';      /* now |lstring.s| is always a valid C string */
-    str_string(str_ptr) = (unsigned char *) cur_string;
+    str_string(str_ptr) = pool_alloc(cur_length + 1);
+    memcpy(str_string(str_ptr), cur_string, cur_length);
+    str_string(str_ptr)[cur_length] = '\0';     /* now |lstring.s| is always a valid C string */
     str_length(str_ptr) = cur_length;
     pool_size += cur_length;
-    reset_cur_string();
+    str_index_add(str_ptr);
+    memset(cur_string, 0, cur_length);
+    cur_length = 0;
 #if 0
     printf("Made a string: %s (s=%d)\n", (char *)str_string(str_ptr), (int)str_ptr);
 #endif
@@ -208,17 +344,17 @@ str_number search_string(str_number search)
     str_number s;               /* running index */
     size_t len;                 /* length of searched string */
     len = str_length(search);
-    if (len == 0) {
+    if (len == 0)
         return get_nullstr();
-    } else {
-        s = search - 1;         /* start search with newest string below |s|; |search>1|! */
-        while (s >= STRING_OFFSET) {
-            /* first |string_offset| strings depend on implementation!! */
-            if (str_length(s) == len)
-                if (str_eq_str(s, search))
-                    return s;
-            s--;
-        }
+    if (str_buckets_size == 0)
+        return 0;
+    s = str_buckets[str_hash(str_string(search), len) & (str_buckets_size - 1)];
+    while (s != 0) {
+        /* the chain is ordered newest first, so skip |search| and anything after it */
+        if (s < search && str_length(s) == len
+            && memcmp(str_string(s), str_string(search), len) == 0)
+            return s;
+        s = str_next(s);
     }
     return 0;
 }
@@ -236,9 +372,14 @@ str_number maketexlstring(const char *s, size_t l)
 {
     if (s == NULL || l == 0)
         return get_nullstr();
-    str_string(str_ptr) = xmalloc((unsigned) (l + 1));
-    memcpy(str_string(str_ptr), s, (l + 1));
+    if (str_ptr == (max_strings + STRING_OFFSET))
+        overflow("number of strings",
+                 (unsigned) (max_strings - init_str_ptr + STRING_OFFSET));
+    str_string(str_ptr) = pool_alloc(l + 1);
+    memcpy(str_string(str_ptr), s, l);
+    str_string(str_ptr)[l] = '\0';
     str_length(str_ptr) = (unsigned) l;
+    str_index_add(str_ptr);
     str_ptr++;
     return (str_ptr - 1);
 }
@@ -279,21 +420,45 @@ char *makeclstring(int s, size_t * len)
     }
 }
 
-@ @c
+@ The format file has the lengths of all strings first ($-1$ for a flushed
+one), followed by their bytes in one block, each string with its
+terminating null. |undump_string_pool| reads that block straight into a
+single chunk and points the strings into it.
+
+@c
 int dump_string_pool(void)
 {
     int j;
-    int l;
     int k = str_ptr;
+    int *lengths;
+    unsigned char *block, *p;
+    size_t total = 0;
     dump_int(k - STRING_OFFSET);
+    if (k <= STRING_OFFSET + 1)
+        return (k - STRING_OFFSET);
+    lengths = xmallocarray(int, (unsigned) (k - STRING_OFFSET - 1));
     for (j = STRING_OFFSET + 1; j < k; j++) {
-        l = (int) str_length(j);
-        if (str_string(j) == NULL)
-            l = -1;
-        dump_int(l);
-        if (l > 0)
-            dump_things(*str_string(j), str_length(j));
+        if (str_string(j) == NULL) {
+            lengths[j - STRING_OFFSET - 1] = -1;
+        } else {
+            lengths[j - STRING_OFFSET - 1] = (int) str_length(j);
+            total += str_length(j) + 1;
+        }
     }
+    dump_things(lengths[0], k - STRING_OFFSET - 1);
+    dump_int((int) total);
+    if (total > 0) {
+        p = block = xmallocarray(unsigned char, total);
+        for (j = STRING_OFFSET + 1; j < k; j++) {
+            if (str_string(j) != NULL) {
+                memcpy(p, str_string(j), str_length(j) + 1);
+                p += str_length(j) + 1;
+            }
+        }
+        dump_things(block[0], total);
+        xfree(block);
+    }
+    xfree(lengths);
     return (k - STRING_OFFSET);
 }
 
@@ -302,6 +467,8 @@ int undump_string_pool(void)
 {
     int j;
     int x;
+    int *lengths;
+    unsigned char *p;
     undump_int(str_ptr);
     if (max_strings < str_ptr + strings_free)
         max_strings = str_ptr + strings_free;
@@ -309,18 +476,37 @@ int undump_string_pool(void)
     if (ini_version)
         libcfree(string_pool);
     init_string_pool_array((unsigned) max_strings);
-    for (j = STRING_OFFSET + 1; j < str_ptr; j++) {
+    if (str_ptr > STRING_OFFSET + 1) {
+        lengths = xmallocarray(int, (unsigned) (str_ptr - STRING_OFFSET - 1));
+        undump_things(lengths[0], str_ptr - STRING_OFFSET - 1);
         undump_int(x);
-        if (x >= 0) {
-            str_length(j) = (unsigned) x;
-            pool_size += (unsigned) x;
-            str_string(j) = xmallocarray(unsigned char, (unsigned) (x + 1));
-            undump_things(*str_string(j), (unsigned) x);
-            *(str_string(j) + str_length(j)) = '\0';
-        } else {
-            str_length(j) = 0;
+        p = NULL;
+        if (x > 0) {
+            p = pool_alloc((size_t) x);
+            undump_things(p[0], x);
         }
+        for (j = STRING_OFFSET + 1; j < str_ptr; j++) {
+            x = lengths[j - STRING_OFFSET - 1];
+            if (x >= 0) {
+                str_length(j) = (unsigned) x;
+                pool_size += (unsigned) x;
+                str_string(j) = p;
+                p += x + 1;
+            } else {
+                str_length(j) = 0;
+            }
+        }
+        xfree(lengths);
+    }
+    str_indexed = 0;
+    for (j = STRING_OFFSET + 1; j < str_ptr; j++) {
+        if (str_string(j) != NULL && str_length(j) > 0)
+            str_indexed++;
     }
+    x = 16384;
+    while ((unsigned) x < str_indexed)
+        x *= 2;
+    str_index_resize((unsigned) x);
     init_str_ptr = str_ptr;
     return str_ptr;
 }
@@ -334,6 +520,12 @@ void init_string_pool_array(unsigned s)
     /* seed the null string */
     string_pool[0].s = xmalloc(1);
     string_pool[0].s[0] = '\0';
+    free_pool_chunks();
+    xfree(str_chain);
+    str_chain = xmallocarray(str_number, s);
+    xfree(str_buckets);
+    str_buckets_size = 0;
+    str_indexed = 0;
 }
 
 @ To destroy an already made string, we say |flush_str|. 
@@ -343,10 +535,13 @@ void flush_str(str_number s)
 #if 0	
     printf("Flushing a string: %s (s=%d,str_ptr=%d)\n", (char *)str_string(s), (int)s, (int)str_ptr); 
 #endif
-    if (s > STRING_OFFSET) {    /* don't ever delete the null string */
+    if (s > STRING_OFFSET && str_string(s) != NULL) {   /* don't ever delete the null string */
         pool_size -= (unsigned) str_length(s);
+        str_index_remove(s);
+        if (s == str_ptr - 1)
+            pool_release(str_string(s), str_length(s) + 1);
         str_length(s) = 0;
-        xfree(str_string(s));
+        str_string(s) = NULL;
     }
     while (str_string((str_ptr - 1)) == NULL)
         str_ptr--;
@@ -123,6 +123,10 @@ extern boolean zopen_w_input(FILE **, const char *, int,
                              const_string fopen_mode);
 extern boolean zopen_w_output(FILE **, const char *, const_string fopen_mode);
 extern void zwclose(FILE *);
+extern boolean zopen_font_file(const char *fname, const char *mode);
+extern int zread_font_file(void *buf, int len);
+extern long ztell_font_file(void);
+extern boolean zclose_font_file(void);
 
 #  define read_tfm_file  readbinfile
 #  define read_vf_file   readbinfile
@@ -77,6 +77,7 @@ extern void after_math(void);
 extern void scan_extdef_del_code(int level, int extcode);
 extern void scan_extdef_math_code(int level, int extcode);
 
+extern int math_data_serial;
 extern int fam_fnt(int fam_id, int size_id);
 extern void def_fam_fnt(int fam_id, int size_id, int f, int lvl);
 extern void dump_math_data(void);
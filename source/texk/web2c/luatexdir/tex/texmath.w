@@ -165,6 +165,14 @@ void flush_math(void)
     incompleat_noad = null;
 }
 
+@ The families and the math parameters together determine how a formula
+is typeset. |math_data_serial| changes whenever one of them is assigned or
+restored, so that |run_mlist_to_hlist| can tell if a formula converted
+earlier is still valid.
+
+@c
+int math_data_serial = 0;
+
 @ Before we can do anything in math mode, we need fonts.
 
 @c
@@ -184,6 +192,7 @@ void def_fam_fnt(int fam_id, int size_id, int f, int lvl)
 {
     int n = fam_id + (256 * size_id);
     set_sa_item(math_fam_head, n, (sa_tree_item) f, lvl);
+    math_data_serial++;
     fixup_math_parameters(fam_id, size_id, f, lvl);
     if (int_par(tracing_assigns_code) > 0) {
         begin_diagnostic();
@@ -210,6 +219,7 @@ static void unsave_math_fam_data(int gl)
         st = math_fam_head->stack[math_fam_head->stack_ptr];
         if (st.level > 0) {
             rawset_sa_item(math_fam_head, st.code, st.value);
+            math_data_serial++;
             /* now do a trace message, if requested */
             if (int_par(tracing_restores_code) > 0) {
                 int size_id = st.code / 256;
@@ -244,6 +254,7 @@ void def_math_param(int param_id, int style_id, scaled value, int lvl)
 {
     int n = param_id + (256 * style_id);
     set_sa_item(math_param_head, n, (sa_tree_item) value, lvl);
+    math_data_serial++;
     if (int_par(tracing_assigns_code) > 0) {
         begin_diagnostic();
         tprint("{assigning");
@@ -276,6 +287,7 @@ static void unsave_math_param_data(int gl)
         st = math_param_head->stack[math_param_head->stack_ptr];
         if (st.level > 0) {
             rawset_sa_item(math_param_head, st.code, st.value);
+            math_data_serial++;
             /* now do a trace message, if requested */
             if (int_par(tracing_restores_code) > 0) {
                 int param_id = st.code % 256;
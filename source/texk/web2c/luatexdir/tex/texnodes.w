@@ -3454,6 +3454,24 @@ scaled glyph_depth(halfword p)
     return w;
 }
 
+@ |glyph_dimensions| combines the three functions above, and needs only one
+lookup of the character. The width is the plain one: |ex_glyph| is left to
+the caller.
+
+@c
+scaled_whd glyph_dimensions(halfword p)
+{
+    scaled_whd whd = get_charinfo_whd(font(p), character(p));
+    whd.ht += y_displace(p);
+    if (whd.ht < 0)
+        whd.ht = 0;
+    if (y_displace(p) > 0)
+        whd.dp -= y_displace(p);
+    if (whd.dp < 0)
+        whd.dp = 0;
+    return whd;
+}
+
 
 @ A |disc_node|, which occurs only in horizontal lists, specifies a
 ``dis\-cretion\-ary'' line break. If such a break occurs at node |p|, the text
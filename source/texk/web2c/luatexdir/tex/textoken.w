@@ -123,6 +123,12 @@ we try first to increase |fix_mem_end|. If that cannot be done, i.e., if
 |fix_mem_end=fix_mem_max|, we try to reallocate array |fixmem|.
 If, that doesn't work, we have to quit.
 
+Virgin territory is taken a chunk at a time: the first node is returned and
+the rest go onto the |avail| list, so that the callers using |fast_get_avail|
+find them there without a procedure call.
+
+@d avail_chunk_size 256
+
 @c
 halfword get_avail(void)
 {                               /* single-word node allocation */
@@ -132,8 +138,18 @@ halfword get_avail(void)
     if (p != null) {
         avail = token_link(avail);      /* and pop it off */
     } else if (fix_mem_end < fix_mem_max) {     /* or go into virgin territory */
-        incr(fix_mem_end);
-        p = fix_mem_end;
+        p = fix_mem_end + 1;
+        t = fix_mem_max - fix_mem_end;
+        if (t > avail_chunk_size)
+            t = avail_chunk_size;
+        fix_mem_end += t;
+        if (t > 1) {
+            unsigned k;
+            for (k = p + 1; k < fix_mem_end; k++)
+                token_link(k) = (halfword) (k + 1);
+            token_link(fix_mem_end) = null;
+            avail = (halfword) (p + 1);
+        }
     } else {
         smemory_word *new_fixmem;       /* the big dynamic storage area */
         t = (fix_mem_max / 5);
@@ -68,6 +68,7 @@ extern void destroy_sa_tree(sa_tree head);
 extern void dump_sa_tree(sa_tree a);
 extern sa_tree undump_sa_tree(void);
 
+extern int sa_stack_level;
 extern void restore_sa_stack(sa_tree a, int gl);
 extern void clear_sa_stack(sa_tree a);
 
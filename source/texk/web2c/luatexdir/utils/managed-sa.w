@@ -24,6 +24,13 @@
 
 #include "ptexlib.h"
 
+@ All the sparse arrays share one bound on the levels of their saved entries.
+When a group ends at a level above |sa_stack_level|, none of the code tables
+has anything to restore and |unsave| can leave them alone altogether.
+
+@c
+int sa_stack_level = 0;         /* no saved entry has a higher level than this */
+
 @ @c
 static void store_sa_stack(sa_tree a, int n, sa_tree_item v, int gl)
 {
@@ -31,6 +38,8 @@ static void store_sa_stack(sa_tree a, int n, sa_tree_item v, int gl)
     st.code = n;
     st.value = v;
     st.level = gl;
+    if (gl > sa_stack_level)
+        sa_stack_level = gl;
     if (a->stack == NULL) {
         a->stack = Mxmalloc_array(sa_stack_item, a->stack_size);
     } else if (((a->stack_ptr) + 1) >= a->stack_size) {
@@ -51,6 +51,7 @@
 #include "mplibps.h"
 #include "mplibsvg.h"
 #include "mplibpng.h"
+#include "md5.h"
 
 int luaopen_mplib(lua_State * L); /* forward */
 
@@ -231,7 +232,7 @@ static const char *no_fields[] =
 typedef enum {
     P_ERROR_LINE, P_MAX_LINE, P_RANDOM_SEED, P_MATH_MODE,
     P_INTERACTION, P_INI_VERSION, P_MEM_NAME, P_JOB_NAME, P_FIND_FILE,
-    P_RUN_SCRIPT, P_MAKE_TEXT, P_SCRIPT_ERROR, P_EXTENSIONS,
+    P_RUN_SCRIPT, P_MAKE_TEXT, P_SCRIPT_ERROR, P_EXTENSIONS, P_CACHE,
     P__SENTINEL } mplib_parm_idx;
 
 typedef struct {
@@ -251,14 +252,60 @@ static mplib_parm_struct mplib_parms[] = {
     {"script_error", P_SCRIPT_ERROR },
     {"extensions",   P_EXTENSIONS   },
     {"math_mode",    P_MATH_MODE    },
+    {"cache",        P_CACHE        },
     {NULL,           P__SENTINEL    }
 };
 
 
+/* A growable byte buffer, used for the output of |fig:pdfcontent| and for
+   the result cache. */
+
+typedef struct {
+    char *data;
+    size_t used;
+    size_t size;
+} mplib_buffer;
+
+static void mplib_buffer_room(mplib_buffer * b, size_t n)
+{
+    if (b->used + n > b->size) {
+        b->size = b->size + b->size / 2 + n + 1024;
+        b->data = realloc(b->data, b->size);
+    }
+}
+
+static void mplib_buffer_add(mplib_buffer * b, const void *s, size_t n)
+{
+    mplib_buffer_room(b, n);
+    memcpy(b->data + b->used, s, n);
+    b->used += n;
+}
+
 /* Start by defining the needed callback routines for the library  */
 
 /* todo: make subtable in registry, beware, for all mp instances */
 
+/* While a cached |execute| runs, the names of the files that are read are
+   collected (as keys) in the |files| table of the cache state of the
+   instance. */
+
+static int mplib_cache_state(lua_State * L, MP mp);
+
+static void mplib_note_file(lua_State * L, MP mp, const char *fname, const char *fmode)
+{
+    if (fname == NULL || fmode[0] != 'r')
+        return;
+    if (!mplib_cache_state(L, mp))
+        return;
+    lua_getfield(L, -1, "files");
+    if (lua_istable(L, -1)) {
+        lua_pushstring(L, fname);
+        lua_pushboolean(L, 1);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 2);
+}
+
 static char *mplib_find_file(MP mp, const char *fname, const char *fmode, int ftype)
 {
     lua_State *L = (lua_State *)mp_userdata(mp);
@@ -282,11 +329,13 @@ static char *mplib_find_file(MP mp, const char *fname, const char *fmode, int ft
         if (x != NULL)
             s = strdup(x);
         lua_pop(L, 1);          /* pop the string */
+        mplib_note_file(L, mp, s, fmode);
         return s;
     } else {
         lua_pop(L, 1);
     }
     if (fmode[0] != 'r' || (!access(fname, R_OK)) || ftype) {
+        mplib_note_file(L, mp, fname, fmode);
         return strdup(fname);
     }
     return NULL;
@@ -399,11 +448,14 @@ static int mplib_make_text_function(lua_State * L)
     return 0;
 }
 
+static void mplib_cache_sync(lua_State * L, MP mp);
+
 static int mplib_get_numeric(lua_State * L)
 {
     MP *mp = is_mp(L, 1);
     if (*mp != NULL) {
         size_t l;
+        mplib_cache_sync(L, *mp);
         const char *s = lua_tolstring(L, 2, &l);
         if (s != NULL) {
             lua_pushnumber(L, mp_get_numeric_value(*mp,s,l));
@@ -419,6 +471,7 @@ static int mplib_get_boolean(lua_State * L)
     MP *mp = is_mp(L, 1);
     if (*mp != NULL) {
         size_t l;
+        mplib_cache_sync(L, *mp);
         const char *s = lua_tolstring(L, 2, &l);
         if (s != NULL) {
             lua_pushboolean(L, mp_get_boolean_value(*mp,s,l));
@@ -434,6 +487,7 @@ static int mplib_get_string(lua_State * L)
     MP *mp = is_mp(L, 1);
     if (*mp != NULL) {
         size_t l;
+        mplib_cache_sync(L, *mp);
         const char *s = lua_tolstring(L, 2, &l);
         if (s != NULL) {
             char *r = mp_get_string_value(*mp,s,l) ;
@@ -447,6 +501,43 @@ static int mplib_get_string(lua_State * L)
     return 1;
 }
 
+/* The cache state of an instance (see |mplib_execute_cached|) is kept in the
+   registry table |mplib.cache|. */
+
+static void mplib_set_cache(lua_State * L, MP mp, const char *dir, const char *seed, size_t l)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, "mplib.cache");
+    if (lua_isnil(L, -1)) {
+        if (dir == NULL) {
+            lua_pop(L, 1);
+            return;
+        }
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, "mplib.cache");
+    }
+    lua_pushlightuserdata(L, mp);
+    if (dir != NULL) {
+        md5_state_t state;
+        md5_byte_t key[16];
+        md5_init(&state);
+        md5_append(&state, (const md5_byte_t *) seed, (int) l);
+        md5_finish(&state, key);
+        lua_newtable(L);
+        lua_pushstring(L, dir);
+        lua_setfield(L, -2, "dir");
+        lua_pushlstring(L, (const char *) key, 16);
+        lua_setfield(L, -2, "key");
+        lua_newtable(L);
+        lua_setfield(L, -2, "replay");
+    } else {
+        lua_pushnil(L);
+    }
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+}
+
 #define xfree(A) if ((A)!=NULL) { free((A)); A = NULL; }
 
 static int mplib_new(lua_State * L)
@@ -455,6 +546,7 @@ static int mplib_new(lua_State * L)
     mp_ptr = lua_newuserdata(L, sizeof(MP *));
     if (mp_ptr) {
         int i;
+        const char *cache = NULL;
         struct MP_options *options = mp_options();
         options->userdata = (void *) L;
         options->noninteractive = 1;    /* required ! */
@@ -522,6 +614,9 @@ static int mplib_new(lua_State * L)
                 case P_EXTENSIONS:
                     options->extensions = (int)lua_tointeger(L, -1);
                     break;
+                case P_CACHE:
+                    cache = lua_tostring(L, -1);
+                    break;
                 default:
                     break;
                 }
@@ -529,6 +624,25 @@ static int mplib_new(lua_State * L)
             }
         }
         *mp_ptr = mp_initialize(options);
+        /* without a seed the random numbers depend on the time */
+        if (*mp_ptr && cache != NULL && options->random_seed != 0) {
+            /* everything that can change the results before any code is run */
+            char seed[128];
+            mplib_buffer b = { NULL, 0, 0 };
+            sprintf(seed, "%d:%d:%d:%d:%d:%d:%d:%d:", options->math_mode,
+                    options->random_seed, options->extensions,
+                    options->error_line, options->half_error_line,
+                    options->max_print_line, options->interaction,
+                    options->ini_version);
+            mplib_buffer_add(&b, seed, strlen(seed));
+            if (options->job_name != NULL)
+                mplib_buffer_add(&b, options->job_name, strlen(options->job_name) + 1);
+            mplib_buffer_add(&b, ":", 1);
+            if (options->mem_name != NULL)
+                mplib_buffer_add(&b, options->mem_name, strlen(options->mem_name) + 1);
+            mplib_set_cache(L, *mp_ptr, cache, b.data, b.used);
+            free(b.data);
+        }
         xfree(options->command_line);
         xfree(options->mem_name);
         free(options);
@@ -546,6 +660,7 @@ static int mplib_collect(lua_State * L)
 {
     MP *mp_ptr = is_mp(L, 1);
     if (*mp_ptr != NULL) {
+      mplib_set_cache(L, *mp_ptr, NULL, NULL, 0);
       (void)mp_finish(*mp_ptr);
       *mp_ptr = NULL;
     }
@@ -600,6 +715,693 @@ static int mplib_wrapresults(lua_State * L, mp_run_data *res, int status)
     return 1;
 }
 
+/* An instance that is created with a |cache| directory keeps the results of
+   |execute| on disk. The key of a chunk is the md5 sum of the key of the
+   previous chunk and the code, starting from the math mode, random seed and
+   extensions of the instance, so a chunk is only found again when all that
+   came before it is the same too. Next to the status, the terminal, error
+   and log output and the figures, an entry holds the names and md5 sums of
+   the files that were read, and it is only used when these are unchanged.
+
+   A chunk that is restored does not change the state of the instance, so
+   its code is remembered. At the first miss all remembered chunks are run
+   (and their results thrown away) before the missed one, and from then on
+   every chunk is run and stored. Chunks that end with an error are not
+   stored. The entries are written in the native byte order and are not
+   meant to be shared between machines. */
+
+#define MPLIB_CACHE_MAGIC "MPlib cache 1\n"
+
+#define mplib_put_field(b,x) mplib_buffer_add(b, &(x), sizeof(x))
+
+static void mplib_put_string(mplib_buffer * b, const char *s, size_t l)
+{
+    unsigned int n = (s == NULL ? 0 : (unsigned int) l + 1);
+    mplib_put_field(b, n);
+    if (n > 0)
+        mplib_buffer_add(b, s, l);
+}
+
+static void mplib_put_knots(mplib_buffer * b, mp_gr_knot h)
+{
+    unsigned int n = 0;
+    mp_gr_knot p = h;
+    if (h != NULL) {
+        do {
+            n++;
+            p = p->next;
+        } while (p != h);
+    }
+    mplib_put_field(b, n);
+    while (n-- > 0) {
+        mplib_put_field(b, p->x_coord);
+        mplib_put_field(b, p->y_coord);
+        mplib_put_field(b, p->left_x);
+        mplib_put_field(b, p->left_y);
+        mplib_put_field(b, p->right_x);
+        mplib_put_field(b, p->right_y);
+        mplib_put_field(b, p->data.types.left_type);
+        mplib_put_field(b, p->data.types.right_type);
+        mplib_put_field(b, p->originator);
+        p = p->next;
+    }
+}
+
+static void mplib_put_object(mplib_buffer * b, struct mp_graphic_object *p)
+{
+    mplib_put_field(b, p->type);
+    switch (p->type) {
+    case mp_fill_code:
+        {
+            mp_fill_object *h = (mp_fill_object *) p;
+            mplib_put_string(b, h->pre_script, h->pre_script ? strlen(h->pre_script) : 0);
+            mplib_put_string(b, h->post_script, h->post_script ? strlen(h->post_script) : 0);
+            mplib_put_field(b, h->color);
+            mplib_put_field(b, h->color_model);
+            mplib_put_field(b, h->ljoin);
+            mplib_put_knots(b, h->path_p);
+            mplib_put_knots(b, h->htap_p);
+            mplib_put_knots(b, h->pen_p);
+            mplib_put_field(b, h->miterlim);
+        }
+        break;
+    case mp_stroked_code:
+        {
+            mp_stroked_object *h = (mp_stroked_object *) p;
+            unsigned int n = 0;
+            mplib_put_string(b, h->pre_script, h->pre_script ? strlen(h->pre_script) : 0);
+            mplib_put_string(b, h->post_script, h->post_script ? strlen(h->post_script) : 0);
+            mplib_put_field(b, h->color);
+            mplib_put_field(b, h->color_model);
+            mplib_put_field(b, h->ljoin);
+            mplib_put_field(b, h->lcap);
+            mplib_put_knots(b, h->path_p);
+            mplib_put_knots(b, h->pen_p);
+            mplib_put_field(b, h->miterlim);
+            if (h->dash_p != NULL) {
+                n = 1;
+                if (h->dash_p->array != NULL)
+                    while (h->dash_p->array[n - 1] != -1)
+                        n++;
+            }
+            /* |n| counts the closing $-1$ too, and is zero for no dash */
+            mplib_put_field(b, n);
+            if (n > 0) {
+                mplib_put_field(b, h->dash_p->offset);
+                mplib_buffer_add(b, h->dash_p->array, (n - 1) * sizeof(double));
+            }
+        }
+        break;
+    case mp_text_code:
+        {
+            mp_text_object *h = (mp_text_object *) p;
+            mplib_put_string(b, h->pre_script, h->pre_script ? strlen(h->pre_script) : 0);
+            mplib_put_string(b, h->post_script, h->post_script ? strlen(h->post_script) : 0);
+            mplib_put_field(b, h->color);
+            mplib_put_field(b, h->color_model);
+            mplib_put_field(b, h->size_index);
+            mplib_put_string(b, h->text_p, h->text_l);
+            mplib_put_string(b, h->font_name, h->font_name ? strlen(h->font_name) : 0);
+            mplib_put_field(b, h->font_dsize);
+            mplib_put_field(b, h->font_n);
+            mplib_put_field(b, h->width);
+            mplib_put_field(b, h->height);
+            mplib_put_field(b, h->depth);
+            mplib_put_field(b, h->tx);
+            mplib_put_field(b, h->ty);
+            mplib_put_field(b, h->txx);
+            mplib_put_field(b, h->txy);
+            mplib_put_field(b, h->tyx);
+            mplib_put_field(b, h->tyy);
+        }
+        break;
+    case mp_start_clip_code:
+        mplib_put_knots(b, ((mp_clip_object *) p)->path_p);
+        break;
+    case mp_start_bounds_code:
+        mplib_put_knots(b, ((mp_bounds_object *) p)->path_p);
+        break;
+    case mp_special_code:
+        {
+            mp_special_object *h = (mp_special_object *) p;
+            mplib_put_string(b, h->pre_script, h->pre_script ? strlen(h->pre_script) : 0);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void mplib_put_figure(mplib_buffer * b, struct mp_edge_object *h)
+{
+    unsigned int n = 0;
+    struct mp_graphic_object *p;
+    mplib_put_string(b, h->filename, h->filename ? strlen(h->filename) : 0);
+    mplib_put_field(b, h->minx);
+    mplib_put_field(b, h->miny);
+    mplib_put_field(b, h->maxx);
+    mplib_put_field(b, h->maxy);
+    mplib_put_field(b, h->width);
+    mplib_put_field(b, h->height);
+    mplib_put_field(b, h->depth);
+    mplib_put_field(b, h->ital_corr);
+    mplib_put_field(b, h->charcode);
+    for (p = h->body; p != NULL; p = p->next)
+        n++;
+    mplib_put_field(b, n);
+    for (p = h->body; p != NULL; p = p->next)
+        mplib_put_object(b, p);
+}
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int bad;
+} mplib_reader;
+
+static void mplib_get(mplib_reader * r, void *x, size_t n)
+{
+    if (r->bad || (size_t) (r->end - r->p) < n) {
+        r->bad = 1;
+        memset(x, 0, n);
+    } else {
+        memcpy(x, r->p, n);
+        r->p += n;
+    }
+}
+
+#define mplib_get_field(r,x) mplib_get(r, &(x), sizeof(x))
+
+/* Returns a pointer into the entry, or |NULL| for a missing string. */
+
+static const char *mplib_get_chars(mplib_reader * r, size_t * l)
+{
+    unsigned int n;
+    const char *s;
+    mplib_get_field(r, n);
+    *l = 0;
+    if (n == 0 || r->bad)
+        return NULL;
+    if ((size_t) (r->end - r->p) < n - 1) {
+        r->bad = 1;
+        return NULL;
+    }
+    s = r->p;
+    r->p += n - 1;
+    *l = n - 1;
+    return s;
+}
+
+static char *mplib_get_strdup(mplib_reader * r, size_t * l)
+{
+    size_t n;
+    const char *s = mplib_get_chars(r, &n);
+    char *t = NULL;
+    if (s != NULL) {
+        t = malloc(n + 1);
+        memcpy(t, s, n);
+        t[n] = '\0';
+    }
+    if (l != NULL)
+        *l = n;
+    return t;
+}
+
+static mp_gr_knot mplib_get_knots(mplib_reader * r)
+{
+    unsigned int n;
+    mp_gr_knot h = NULL, q = NULL;
+    mplib_get_field(r, n);
+    while (n-- > 0 && !r->bad) {
+        mp_gr_knot p = calloc(1, sizeof(struct mp_gr_knot_data));
+        mplib_get_field(r, p->x_coord);
+        mplib_get_field(r, p->y_coord);
+        mplib_get_field(r, p->left_x);
+        mplib_get_field(r, p->left_y);
+        mplib_get_field(r, p->right_x);
+        mplib_get_field(r, p->right_y);
+        mplib_get_field(r, p->data.types.left_type);
+        mplib_get_field(r, p->data.types.right_type);
+        mplib_get_field(r, p->originator);
+        if (h == NULL)
+            h = p;
+        else
+            q->next = p;
+        q = p;
+    }
+    if (q != NULL)
+        q->next = h;
+    return h;
+}
+
+static struct mp_graphic_object *mplib_get_object(mplib_reader * r)
+{
+    int type;
+    size_t size;
+    struct mp_graphic_object *p;
+    mplib_get_field(r, type);
+    switch (type) {
+    case mp_fill_code:         size = sizeof(mp_fill_object);    break;
+    case mp_stroked_code:      size = sizeof(mp_stroked_object); break;
+    case mp_text_code:         size = sizeof(mp_text_object);    break;
+    case mp_start_clip_code:   size = sizeof(mp_clip_object);    break;
+    case mp_start_bounds_code: size = sizeof(mp_bounds_object);  break;
+    case mp_special_code:      size = sizeof(mp_special_object); break;
+    case mp_stop_clip_code:
+    case mp_stop_bounds_code:  size = sizeof(mp_graphic_object); break;
+    default:
+        r->bad = 1;
+        return NULL;
+    }
+    p = calloc(1, size);
+    p->type = type;
+    switch (type) {
+    case mp_fill_code:
+        {
+            mp_fill_object *h = (mp_fill_object *) p;
+            h->pre_script = mplib_get_strdup(r, NULL);
+            h->post_script = mplib_get_strdup(r, NULL);
+            mplib_get_field(r, h->color);
+            mplib_get_field(r, h->color_model);
+            mplib_get_field(r, h->ljoin);
+            h->path_p = mplib_get_knots(r);
+            h->htap_p = mplib_get_knots(r);
+            h->pen_p = mplib_get_knots(r);
+            mplib_get_field(r, h->miterlim);
+        }
+        break;
+    case mp_stroked_code:
+        {
+            mp_stroked_object *h = (mp_stroked_object *) p;
+            unsigned int n;
+            h->pre_script = mplib_get_strdup(r, NULL);
+            h->post_script = mplib_get_strdup(r, NULL);
+            mplib_get_field(r, h->color);
+            mplib_get_field(r, h->color_model);
+            mplib_get_field(r, h->ljoin);
+            mplib_get_field(r, h->lcap);
+            h->path_p = mplib_get_knots(r);
+            h->pen_p = mplib_get_knots(r);
+            mplib_get_field(r, h->miterlim);
+            mplib_get_field(r, n);
+            if (n > 0 && !r->bad && (size_t) (r->end - r->p) >= n * sizeof(double)) {
+                h->dash_p = malloc(sizeof(mp_dash_object));
+                h->dash_p->array = malloc(n * sizeof(double));
+                mplib_get_field(r, h->dash_p->offset);
+                mplib_get(r, h->dash_p->array, (n - 1) * sizeof(double));
+                h->dash_p->array[n - 1] = -1;
+            } else if (n > 0) {
+                r->bad = 1;
+            }
+        }
+        break;
+    case mp_text_code:
+        {
+            mp_text_object *h = (mp_text_object *) p;
+            h->pre_script = mplib_get_strdup(r, NULL);
+            h->post_script = mplib_get_strdup(r, NULL);
+            mplib_get_field(r, h->color);
+            mplib_get_field(r, h->color_model);
+            mplib_get_field(r, h->size_index);
+            h->text_p = mplib_get_strdup(r, &h->text_l);
+            h->font_name = mplib_get_strdup(r, NULL);
+            mplib_get_field(r, h->font_dsize);
+            mplib_get_field(r, h->font_n);
+            mplib_get_field(r, h->width);
+            mplib_get_field(r, h->height);
+            mplib_get_field(r, h->depth);
+            mplib_get_field(r, h->tx);
+            mplib_get_field(r, h->ty);
+            mplib_get_field(r, h->txx);
+            mplib_get_field(r, h->txy);
+            mplib_get_field(r, h->tyx);
+            mplib_get_field(r, h->tyy);
+        }
+        break;
+    case mp_start_clip_code:
+        ((mp_clip_object *) p)->path_p = mplib_get_knots(r);
+        break;
+    case mp_start_bounds_code:
+        ((mp_bounds_object *) p)->path_p = mplib_get_knots(r);
+        break;
+    case mp_special_code:
+        ((mp_special_object *) p)->pre_script = mplib_get_strdup(r, NULL);
+        break;
+    default:
+        break;
+    }
+    return p;
+}
+
+static struct mp_edge_object *mplib_get_figure(mplib_reader * r, MP mp)
+{
+    unsigned int n;
+    struct mp_graphic_object *p, *q = NULL;
+    struct mp_edge_object *h = calloc(1, sizeof(struct mp_edge_object));
+    h->parent = mp;
+    h->filename = mplib_get_strdup(r, NULL);
+    mplib_get_field(r, h->minx);
+    mplib_get_field(r, h->miny);
+    mplib_get_field(r, h->maxx);
+    mplib_get_field(r, h->maxy);
+    mplib_get_field(r, h->width);
+    mplib_get_field(r, h->height);
+    mplib_get_field(r, h->depth);
+    mplib_get_field(r, h->ital_corr);
+    mplib_get_field(r, h->charcode);
+    mplib_get_field(r, n);
+    while (n-- > 0 && !r->bad) {
+        p = mplib_get_object(r);
+        if (p == NULL)
+            break;
+        if (q == NULL)
+            h->body = p;
+        else
+            q->next = p;
+        q = p;
+    }
+    return h;
+}
+
+static void mplib_toss_figures(struct mp_edge_object *p)
+{
+    while (p != NULL) {
+        struct mp_edge_object *q = p->next;
+        mp_gr_toss_objects(p);
+        p = q;
+    }
+}
+
+/* A file that cannot be read gets an empty digest, so that its absence is
+   checked as well. */
+
+static void mplib_file_digest(const char *fname, md5_byte_t * digest)
+{
+    char buf[8192];
+    size_t n;
+    md5_state_t state;
+    FILE *f = fopen(fname, "rb");
+    memset(digest, 0, 16);
+    if (f == NULL)
+        return;
+    md5_init(&state);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        md5_append(&state, (const md5_byte_t *) buf, (int) n);
+    fclose(f);
+    md5_finish(&state, digest);
+}
+
+static void mplib_cache_store(lua_State * L, int state, const char *name, mp_run_data * res, int status)
+{
+    mplib_buffer b = { NULL, 0, 0 };
+    unsigned int n = 0;
+    struct mp_edge_object *p;
+    char *tmp;
+    FILE *f;
+    mplib_buffer_add(&b, MPLIB_CACHE_MAGIC, strlen(MPLIB_CACHE_MAGIC));
+    mplib_put_field(&b, status);
+    mplib_put_string(&b, res->term_out.data, res->term_out.used);
+    mplib_put_string(&b, res->error_out.data, res->error_out.used);
+    mplib_put_string(&b, res->log_out.data, res->log_out.used);
+    lua_getfield(L, state, "files");
+    if (lua_istable(L, -1)) {
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            n++;
+            lua_pop(L, 1);
+        }
+    }
+    mplib_put_field(&b, n);
+    if (n > 0) {
+        lua_pushnil(L);
+        while (lua_next(L, -2) != 0) {
+            size_t l;
+            md5_byte_t digest[16];
+            const char *s = lua_tolstring(L, -2, &l);
+            mplib_put_string(&b, s, l);
+            mplib_file_digest(s, digest);
+            mplib_buffer_add(&b, digest, 16);
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+    n = 0;
+    for (p = res->edges; p != NULL; p = p->next)
+        n++;
+    mplib_put_field(&b, n);
+    for (p = res->edges; p != NULL; p = p->next)
+        mplib_put_figure(&b, p);
+    /* write a temporary file first, so that an entry is complete or absent */
+    tmp = malloc(strlen(name) + 5);
+    sprintf(tmp, "%s.tmp", name);
+    f = fopen(tmp, "wb");
+    if (f != NULL) {
+        int ok = (fwrite(b.data, 1, b.used, f) == b.used);
+        if (fclose(f) == 0 && ok)
+            ok = (rename(tmp, name) == 0);
+        if (!ok)
+            remove(tmp);
+    }
+    free(tmp);
+    free(b.data);
+}
+
+/* Pushes the results and returns 1 when |name| holds a valid entry. */
+
+static int mplib_cache_restore(lua_State * L, MP mp, const char *name)
+{
+    FILE *f;
+    long size;
+    char *data;
+    mplib_reader r;
+    mp_run_data res;
+    int status;
+    unsigned int n;
+    struct mp_edge_object *q = NULL;
+    f = fopen(name, "rb");
+    if (f == NULL)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(f);
+        return 0;
+    }
+    data = malloc((size_t) size);
+    if (fread(data, 1, (size_t) size, f) != (size_t) size) {
+        fclose(f);
+        free(data);
+        return 0;
+    }
+    fclose(f);
+    r.p = data;
+    r.end = data + size;
+    r.bad = 0;
+    memset(&res, 0, sizeof(mp_run_data));
+    if ((size_t) size < strlen(MPLIB_CACHE_MAGIC)
+        || memcmp(data, MPLIB_CACHE_MAGIC, strlen(MPLIB_CACHE_MAGIC)) != 0) {
+        free(data);
+        return 0;
+    }
+    r.p += strlen(MPLIB_CACHE_MAGIC);
+    mplib_get_field(&r, status);
+    res.term_out.data = (char *) mplib_get_chars(&r, &res.term_out.used);
+    res.error_out.data = (char *) mplib_get_chars(&r, &res.error_out.used);
+    res.log_out.data = (char *) mplib_get_chars(&r, &res.log_out.used);
+    mplib_get_field(&r, n);
+    while (n-- > 0 && !r.bad) {
+        size_t l;
+        md5_byte_t digest[16], stored[16];
+        char *s = mplib_get_strdup(&r, &l);
+        mplib_get(&r, stored, 16);
+        if (s != NULL) {
+            mplib_file_digest(s, digest);
+            free(s);
+        }
+        if (s == NULL || memcmp(digest, stored, 16) != 0)
+            r.bad = 1;
+    }
+    mplib_get_field(&r, n);
+    while (n-- > 0 && !r.bad) {
+        struct mp_edge_object *p = mplib_get_figure(&r, mp);
+        if (q == NULL)
+            res.edges = p;
+        else
+            q->next = p;
+        q = p;
+    }
+    if (r.bad) {
+        mplib_toss_figures(res.edges);
+        free(data);
+        return 0;
+    }
+    mplib_wrapresults(L, &res, status);
+    free(data);
+    return 1;
+}
+
+/* Pushes the cache state of the instance, or nothing if it has none. */
+
+static int mplib_cache_state(lua_State * L, MP mp)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, "mplib.cache");
+    if (lua_istable(L, -1)) {
+        lua_pushlightuserdata(L, mp);
+        lua_rawget(L, -2);
+        lua_remove(L, -2);
+        if (lua_istable(L, -1))
+            return 1;
+    }
+    lua_pop(L, 1);
+    return 0;
+}
+
+/* Chunks whose results came from the cache have not been run; they are
+   kept in |replay| and executed before the instance does any real work. */
+
+static void mplib_cache_catch_up(lua_State * L, MP mp, int state)
+{
+    int i;
+    lua_getfield(L, state, "live");
+    if (lua_toboolean(L, -1)) {
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pop(L, 1);
+    lua_pushboolean(L, 1);
+    lua_setfield(L, state, "live");
+    lua_getfield(L, state, "replay");
+    for (i = 1; i <= (int) lua_objlen(L, -1); i++) {
+        size_t rl;
+        char *s;
+        mp_run_data *res;
+        lua_rawgeti(L, -1, i);
+        s = xstrdup(lua_tolstring(L, -1, &rl));
+        (void) mp_execute(mp, s, rl);
+        free(s);
+        res = mp_rundata(mp);
+        mplib_toss_figures(res->edges);
+        res->edges = NULL;
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_setfield(L, state, "replay");
+}
+
+/* Everything that looks at the state of an instance other than |execute|
+   has to see the chunks that were taken from the cache as well. */
+
+static void mplib_cache_sync(lua_State * L, MP mp)
+{
+    if (mplib_cache_state(L, mp)) {
+        mplib_cache_catch_up(L, mp, lua_gettop(L));
+        lua_pop(L, 1);
+    }
+}
+
+/* What |run_script| and |make_text| return is up to Lua and cannot be
+   checked when an entry is restored, so the cache is only used as long
+   as neither of them is set. */
+
+static int mplib_cache_usable(lua_State * L)
+{
+    int usable;
+    lua_getfield(L, LUA_REGISTRYINDEX, "mplib.run_script");
+    lua_getfield(L, LUA_REGISTRYINDEX, "mplib.make_text");
+    usable = !lua_isfunction(L, -1) && !lua_isfunction(L, -2);
+    lua_pop(L, 2);
+    return usable;
+}
+
+/* A |code| of zero stands for the final run of |mp:finish|. */
+
+static int mplib_execute_cached(lua_State * L, MP mp, int code, int state)
+{
+    size_t l = 0, dl;
+    int h, i, files;
+    const char *c = (code != 0 ? lua_tolstring(L, code, &l) : "\0end");
+    const char *dir;
+    char *s, *name;
+    md5_state_t md5;
+    md5_byte_t key[16];
+    mp_run_data *res;
+    lua_getfield(L, state, "key");
+    md5_init(&md5);
+    md5_append(&md5, (const md5_byte_t *) lua_tostring(L, -1), 16);
+    md5_append(&md5, (const md5_byte_t *) c, (int) (code != 0 ? l : 4));
+    md5_finish(&md5, key);
+    lua_pop(L, 1);
+    lua_pushlstring(L, (const char *) key, 16);
+    lua_setfield(L, state, "key");
+    lua_getfield(L, state, "dir");
+    dir = lua_tolstring(L, -1, &dl);
+    name = malloc(dl + 38);
+    memcpy(name, dir, dl);
+    name[dl] = '/';
+    for (i = 0; i < 16; i++)
+        sprintf(name + dl + 1 + 2 * i, "%02x", key[i]);
+    strcpy(name + dl + 33, ".mpc");
+    lua_pop(L, 1);
+    lua_getfield(L, state, "live");
+    if (!lua_toboolean(L, -1)) {
+        lua_pop(L, 1);
+        if (mplib_cache_restore(L, mp, name)) {
+            if (code != 0) {
+                lua_getfield(L, state, "replay");
+                lua_pushvalue(L, code);
+                lua_rawseti(L, -2, (int) lua_objlen(L, -2) + 1);
+                lua_pop(L, 1);
+            }
+            free(name);
+            return 1;
+        }
+        mplib_cache_catch_up(L, mp, state);
+    } else {
+        lua_pop(L, 1);
+    }
+    /* keep the file list of an |execute| that is still running (a nested
+       call from a callback) and put it back afterwards */
+    lua_getfield(L, state, "files");
+    files = lua_gettop(L);
+    lua_newtable(L);
+    lua_setfield(L, state, "files");
+    s = (code != 0 ? xstrdup(c) : NULL);
+    h = mp_execute(mp, s, l);
+    free(s);
+    res = mp_rundata(mp);
+    if (h <= mp_warning_issued && mplib_cache_usable(L))
+        mplib_cache_store(L, state, name, res, h);
+    lua_pushvalue(L, files);
+    lua_setfield(L, state, "files");
+    lua_pop(L, 1);
+    free(name);
+    return mplib_wrapresults(L, res, h);
+}
+
+/* Runs the chunk at stack index |code|, through the cache when the instance
+   has one, and pushes the result table. */
+
+static int mplib_execute_chunk(lua_State * L, MP mp, int code)
+{
+    size_t l;
+    char *s;
+    int h;
+    if (mplib_cache_state(L, mp)) {
+        if (mplib_cache_usable(L))
+            return mplib_execute_cached(L, mp, code, lua_gettop(L));
+        /* a callback has been set since: finish the replay and stop caching */
+        mplib_cache_catch_up(L, mp, lua_gettop(L));
+        lua_pop(L, 1);
+        mplib_set_cache(L, mp, NULL, NULL, 0);
+    }
+    s = xstrdup(lua_tolstring(L, code, &l));
+    h = mp_execute(mp, s, l);
+    free(s);
+    return mplib_wrapresults(L, mp_rundata(mp), h);
+}
+
 static int mplib_execute(lua_State * L)
 {
     MP *mp_ptr;
@@ -609,12 +1411,7 @@ static int mplib_execute(lua_State * L)
     }
     mp_ptr = is_mp(L, 1);
     if (*mp_ptr != NULL && lua_isstring(L, 2)) {
-        size_t l;
-        char *s = xstrdup(lua_tolstring(L, 2, &l));
-        int h = mp_execute(*mp_ptr, s, l);
-        mp_run_data *res = mp_rundata(*mp_ptr);
-        free(s);
-        return mplib_wrapresults(L, res, h);
+        return mplib_execute_chunk(L, *mp_ptr, 2);
     } else {
         lua_pushnil(L);
     }
@@ -626,9 +1423,17 @@ static int mplib_finish(lua_State * L)
     MP *mp_ptr = is_mp(L, 1);
     if (*mp_ptr != NULL) {
       int i;
-      int h = mp_execute(*mp_ptr,NULL,0);
-      mp_run_data *res = mp_rundata(*mp_ptr);
-      i = mplib_wrapresults(L, res, h);
+      int state = (mplib_cache_state(L, *mp_ptr) ? lua_gettop(L) : 0);
+      if (state != 0 && mplib_cache_usable(L)) {
+          i = mplib_execute_cached(L, *mp_ptr, 0, state);
+      } else {
+          int h;
+          if (state != 0)
+              mplib_cache_catch_up(L, *mp_ptr, state);
+          h = mp_execute(*mp_ptr,NULL,0);
+          i = mplib_wrapresults(L, mp_rundata(*mp_ptr), h);
+      }
+      mplib_set_cache(L, *mp_ptr, NULL, NULL, 0);
       (void)mp_finish(*mp_ptr);
        *mp_ptr = NULL;
        return i;
@@ -692,6 +1497,12 @@ static int mplib_statistics(lua_State * L)
         lua_setfield(L, -2, "params");
         lua_pushnumber(L, (lua_Number)mp_open_usage(*mp_ptr));
         lua_setfield(L, -2, "open");
+        lua_pushnumber(L, (lua_Number)mp_slab_count(*mp_ptr));
+        lua_setfield(L, -2, "slabs");
+        lua_pushnumber(L, (lua_Number)mp_slab_usage(*mp_ptr));
+        lua_setfield(L, -2, "slabmemory");
+        lua_pushnumber(L, (lua_Number)mp_free_node_count(*mp_ptr));
+        lua_setfield(L, -2, "freenodes");
     } else {
         lua_pushnil(L);
     }
@@ -900,6 +1711,7 @@ static int mplib_solve_path(lua_State * L)
 	goto BAD;
     }
     mp = *mp_ptr;
+    mplib_cache_sync(L, mp);
     cyclic = lua_toboolean(L,3);
     lua_pop(L,1);
 
@@ -1317,27 +2129,29 @@ static double coord_range_y (mp_gr_knot h, double dz) {
 }
 
 
-static int mplib_gr_peninfo(lua_State * L) {
+typedef struct {
+    double width;
+    double rx, sx, sy, ry, tx, ty;
+} mplib_pen_info;
+
+/* Find the transformation that maps a unit circle onto the elliptical pen of
+   a fill or stroke object, and the line width that goes with it. Returns 0 if
+   the object has no pen. */
+
+static int mplib_get_pen_info(struct mp_graphic_object *h, mplib_pen_info * pen)
+{
     double x_coord, y_coord, left_x, left_y, right_x, right_y;
     double wx, wy;
-    double rx = 1.0, sx = 0.0, sy = 0.0, ry = 1.0, tx = 0.0, ty = 0.0;
-    double width = 1.0;
     mp_gr_knot p = NULL, path = NULL;
-    struct mp_graphic_object **hh = is_gr_object(L, -1);
-    if (!*hh) {
-      lua_pushnil(L);
-      return 1;
-    }
-    if ((*hh)->type == mp_fill_code) {
-      p    = ((mp_fill_object *)(*hh))->pen_p;
-      path = ((mp_fill_object *)(*hh))->path_p;
-    } else if ((*hh)->type == mp_stroked_code) {
-      p    = ((mp_stroked_object *)(*hh))->pen_p;
-      path = ((mp_stroked_object *)(*hh))->path_p;
+    if (h->type == mp_fill_code) {
+      p    = ((mp_fill_object *)h)->pen_p;
+      path = ((mp_fill_object *)h)->path_p;
+    } else if (h->type == mp_stroked_code) {
+      p    = ((mp_stroked_object *)h)->pen_p;
+      path = ((mp_stroked_object *)h)->path_p;
     }
     if (p==NULL || path == NULL) {
-      lua_pushnil(L);
-      return 1;
+      return 0;
     }
     x_coord = p->x_coord;
     y_coord = p->y_coord;
@@ -1353,35 +2167,316 @@ static int mplib_gr_peninfo(lua_State * L) {
       wy = pyth(left_y - y_coord, right_y - y_coord);
     }
     if ((wy/coord_range_x(path, wx)) >= (wx/coord_range_y(path, wy)))
-      width = wy;
+      pen->width = wy;
     else
-      width = wx;
-    tx = x_coord;
-    ty = y_coord;
-    sx = left_x - tx;
-    rx = left_y - ty;
-    ry = right_x - tx;
-    sy = right_y - ty;
-    if (width !=1.0) {
-      if (width == 0.0) {
-        sx = 1.0; sy = 1.0;
+      pen->width = wx;
+    pen->tx = x_coord;
+    pen->ty = y_coord;
+    pen->sx = left_x - pen->tx;
+    pen->rx = left_y - pen->ty;
+    pen->ry = right_x - pen->tx;
+    pen->sy = right_y - pen->ty;
+    if (pen->width !=1.0) {
+      if (pen->width == 0.0) {
+        pen->sx = 1.0; pen->sy = 1.0;
       } else {
-        rx/=width; ry/=width; sx/=width; sy/=width;
+        pen->rx/=pen->width; pen->ry/=pen->width; pen->sx/=pen->width; pen->sy/=pen->width;
       }
     }
-    if (fabs(sx) < eps) sx = eps;
-    if (fabs(sy) < eps) sy = eps;
+    if (fabs(pen->sx) < eps) pen->sx = eps;
+    if (fabs(pen->sy) < eps) pen->sy = eps;
+    return 1;
+}
+
+static int mplib_gr_peninfo(lua_State * L) {
+    mplib_pen_info pen;
+    struct mp_graphic_object **hh = is_gr_object(L, -1);
+    if (!*hh || !mplib_get_pen_info(*hh, &pen)) {
+      lua_pushnil(L);
+      return 1;
+    }
     lua_newtable(L);
-    lua_pushnumber(L,width); lua_setfield(L,-2,"width");
-    lua_pushnumber(L,rx); lua_setfield(L,-2,"rx");
-    lua_pushnumber(L,sx); lua_setfield(L,-2,"sx");
-    lua_pushnumber(L,sy); lua_setfield(L,-2,"sy");
-    lua_pushnumber(L,ry); lua_setfield(L,-2,"ry");
-    lua_pushnumber(L,tx); lua_setfield(L,-2,"tx");
-    lua_pushnumber(L,ty); lua_setfield(L,-2,"ty");
+    lua_pushnumber(L,pen.width); lua_setfield(L,-2,"width");
+    lua_pushnumber(L,pen.rx); lua_setfield(L,-2,"rx");
+    lua_pushnumber(L,pen.sx); lua_setfield(L,-2,"sx");
+    lua_pushnumber(L,pen.sy); lua_setfield(L,-2,"sy");
+    lua_pushnumber(L,pen.ry); lua_setfield(L,-2,"ry");
+    lua_pushnumber(L,pen.tx); lua_setfield(L,-2,"tx");
+    lua_pushnumber(L,pen.ty); lua_setfield(L,-2,"ty");
+    return 1;
+}
+
+/* |fig:pdfcontent()| turns the paths of a figure into PDF page content,
+   in the same coordinates as |fig:postscript()| uses. It returns an array
+   in which strings of content alternate with graphic objects that are left
+   to the caller: text and special objects, and fills and strokes that carry
+   a pre- or postscript (those usually ask for something the backend has to
+   do). Each fill or stroke is wrapped in its own q/Q pair, clips open one
+   that the matching stop_clip closes, and bounds are ignored. */
+
+static void mplib_pdf_string(mplib_buffer * b, const char *s)
+{
+    mplib_buffer_add(b, s, strlen(s));
+}
+
+/* Numbers get at most five decimals, trailing zeros removed. */
+
+static void mplib_pdf_number(mplib_buffer * b, double d)
+{
+    char *s, *e;
+    int n;
+    if (fabs(d) < 0.000005)
+        d = 0.0;
+    mplib_buffer_room(b, 32);
+    n = snprintf(b->data + b->used, 32, "%.5f", d);
+    if (n >= 32) {
+        /* a huge coordinate: make room for all of its digits */
+        mplib_buffer_room(b, (size_t) n + 1);
+        n = snprintf(b->data + b->used, (size_t) n + 1, "%.5f", d);
+    }
+    s = b->data + b->used;
+    e = s + n;
+    if (strchr(s, '.') != NULL) {
+        while (e[-1] == '0')
+            e--;
+        if (e[-1] == '.')
+            e--;
+    }
+    *e++ = ' ';
+    b->used = (size_t) (e - b->data);
+}
+
+static void mplib_pdf_pair(mplib_buffer * b, double x, double y, mplib_pen_info * pen)
+{
+    if (pen != NULL) {
+        /* undo the pen transformation that has been concatenated already */
+        double d = pen->sx * pen->sy - pen->rx * pen->ry;
+        double px = x - pen->tx, py = y - pen->ty;
+        x = (pen->sy * px - pen->ry * py) / d;
+        y = (pen->sx * py - pen->rx * px) / d;
+    }
+    mplib_pdf_number(b, x);
+    mplib_pdf_number(b, y);
+}
+
+#define mplib_bend_tolerance (131/65536.0)
+
+static int mplib_is_curved(mp_gr_knot p, mp_gr_knot q)
+{
+    double d;
+    if (p->right_x == p->x_coord && p->right_y == p->y_coord
+        && q->left_x == q->x_coord && q->left_y == q->y_coord)
+        return 0;
+    d = q->left_x - p->right_x;
+    if (fabs(p->right_x - p->x_coord - d) <= mplib_bend_tolerance
+        && fabs(q->x_coord - q->left_x - d) <= mplib_bend_tolerance) {
+        d = q->left_y - p->right_y;
+        if (fabs(p->right_y - p->y_coord - d) <= mplib_bend_tolerance
+            && fabs(q->y_coord - q->left_y - d) <= mplib_bend_tolerance)
+            return 0;
+    }
     return 1;
 }
 
+static void mplib_pdf_path(mplib_buffer * b, mp_gr_knot h, mplib_pen_info * pen)
+{
+    mp_gr_knot p, q;
+    mplib_pdf_pair(b, h->x_coord, h->y_coord, pen);
+    mplib_pdf_string(b, "m\n");
+    p = h;
+    do {
+        if (p->data.types.right_type == mp_endpoint) {
+            if (p == h) {
+                mplib_pdf_pair(b, h->x_coord, h->y_coord, pen);
+                mplib_pdf_string(b, "l\n");
+            }
+            return;
+        }
+        q = p->next;
+        if (mplib_is_curved(p, q)) {
+            mplib_pdf_pair(b, p->right_x, p->right_y, pen);
+            mplib_pdf_pair(b, q->left_x, q->left_y, pen);
+            mplib_pdf_pair(b, q->x_coord, q->y_coord, pen);
+            mplib_pdf_string(b, "c\n");
+        } else if (q != h) {
+            mplib_pdf_pair(b, q->x_coord, q->y_coord, pen);
+            mplib_pdf_string(b, "l\n");
+        }
+        p = q;
+    } while (p != h);
+    mplib_pdf_string(b, "h\n");
+}
+
+static void mplib_pdf_color(mplib_buffer * b, int model, mp_color * c)
+{
+    if (model == mp_grey_model) {
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_string(b, "g ");
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_string(b, "G\n");
+    } else if (model == mp_rgb_model) {
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_number(b, c->b_val);
+        mplib_pdf_number(b, c->c_val);
+        mplib_pdf_string(b, "rg ");
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_number(b, c->b_val);
+        mplib_pdf_number(b, c->c_val);
+        mplib_pdf_string(b, "RG\n");
+    } else if (model == mp_cmyk_model) {
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_number(b, c->b_val);
+        mplib_pdf_number(b, c->c_val);
+        mplib_pdf_number(b, c->d_val);
+        mplib_pdf_string(b, "k ");
+        mplib_pdf_number(b, c->a_val);
+        mplib_pdf_number(b, c->b_val);
+        mplib_pdf_number(b, c->c_val);
+        mplib_pdf_number(b, c->d_val);
+        mplib_pdf_string(b, "K\n");
+    }
+}
+
+static void mplib_pdf_line_style(mplib_buffer * b, struct mp_graphic_object *h)
+{
+    unsigned char ljoin;
+    double miterlim;
+    if (h->type == mp_fill_code) {
+        ljoin = ((mp_fill_object *) h)->ljoin;
+        miterlim = ((mp_fill_object *) h)->miterlim;
+    } else {
+        mp_stroked_object *s = (mp_stroked_object *) h;
+        ljoin = s->ljoin;
+        miterlim = s->miterlim;
+        if (s->lcap != 0) {
+            mplib_pdf_number(b, (double) s->lcap);
+            mplib_pdf_string(b, "J\n");
+        }
+        if (s->dash_p != NULL && s->dash_p->array != NULL) {
+            int i;
+            mplib_pdf_string(b, "[");
+            for (i = 0; s->dash_p->array[i] != -1; i++)
+                mplib_pdf_number(b, s->dash_p->array[i]);
+            mplib_pdf_string(b, "] ");
+            mplib_pdf_number(b, s->dash_p->offset);
+            mplib_pdf_string(b, "d\n");
+        }
+    }
+    if (ljoin != 0) {
+        mplib_pdf_number(b, (double) ljoin);
+        mplib_pdf_string(b, "j\n");
+    }
+    if (miterlim != 10.0) {
+        /* 10 is the PDF default */
+        mplib_pdf_number(b, miterlim);
+        mplib_pdf_string(b, "M\n");
+    }
+}
+
+/* Fills without a pen are filled, strokes and fills with an elliptical pen
+   are stroked in a coordinate system where that pen is a circle, and for a
+   polygonal pen the envelope that \MP\ has computed is filled. */
+
+static void mplib_pdf_object(mplib_buffer * b, struct mp_graphic_object *h)
+{
+    mplib_pen_info pen;
+    mp_gr_knot path, pen_p;
+    int transformed = 0;
+    mplib_pdf_string(b, "q\n");
+    if (h->type == mp_fill_code) {
+        mp_fill_object *f = (mp_fill_object *) h;
+        path = f->path_p;
+        pen_p = f->pen_p;
+        mplib_pdf_color(b, f->color_model, &f->color);
+    } else {
+        mp_stroked_object *s = (mp_stroked_object *) h;
+        path = s->path_p;
+        pen_p = s->pen_p;
+        mplib_pdf_color(b, s->color_model, &s->color);
+    }
+    if (pen_p != NULL && pen_p == pen_p->next && mplib_get_pen_info(h, &pen)) {
+        mplib_pdf_line_style(b, h);
+        mplib_pdf_number(b, pen.width);
+        mplib_pdf_string(b, "w\n");
+        if (!(pen.sx == 1.0 && pen.rx == 0.0 && pen.ry == 0.0 && pen.sy == 1.0
+              && pen.tx == 0.0 && pen.ty == 0.0)
+            && pen.sx * pen.sy - pen.rx * pen.ry != 0.0) {
+            transformed = 1;
+            mplib_pdf_number(b, pen.sx);
+            mplib_pdf_number(b, pen.rx);
+            mplib_pdf_number(b, pen.ry);
+            mplib_pdf_number(b, pen.sy);
+            mplib_pdf_number(b, pen.tx);
+            mplib_pdf_number(b, pen.ty);
+            mplib_pdf_string(b, "cm\n");
+        }
+        mplib_pdf_path(b, path, transformed ? &pen : NULL);
+        mplib_pdf_string(b, h->type == mp_fill_code ? "B\n" : "S\n");
+    } else {
+        mplib_pdf_path(b, path, NULL);
+        mplib_pdf_string(b, "f\n");
+        if (h->type == mp_fill_code && ((mp_fill_object *) h)->htap_p != NULL) {
+            mplib_pdf_path(b, ((mp_fill_object *) h)->htap_p, NULL);
+            mplib_pdf_string(b, "f\n");
+        }
+    }
+    mplib_pdf_string(b, "Q\n");
+}
+
+static void mplib_pdf_flush(lua_State * L, mplib_buffer * b, int *n)
+{
+    if (b->used > 0) {
+        lua_pushlstring(L, b->data, b->used);
+        lua_rawseti(L, -2, ++(*n));
+        b->used = 0;
+    }
+}
+
+static int mplib_fig_pdfcontent(lua_State * L)
+{
+    struct mp_edge_object **hh = is_fig(L, 1);
+    struct mp_graphic_object *p;
+    mplib_buffer b = { NULL, 0, 0 };
+    int n = 0;
+    lua_newtable(L);
+    for (p = (*hh)->body; p != NULL; p = p->next) {
+        switch (p->type) {
+        case mp_fill_code:
+        case mp_stroked_code:
+            if (((mp_fill_object *) p)->pre_script == NULL
+                && ((mp_fill_object *) p)->post_script == NULL) {
+                mplib_pdf_object(&b, p);
+                break;
+            }
+            /* fall through */
+        case mp_text_code:
+        case mp_special_code:
+            {
+                struct mp_graphic_object **v;
+                mplib_pdf_flush(L, &b, &n);
+                v = lua_newuserdata(L, sizeof(struct mp_graphic_object *));
+                *v = mp_gr_copy_object((*hh)->parent, p);
+                luaL_getmetatable(L, MPLIB_GR_METATABLE);
+                lua_setmetatable(L, -2);
+                lua_rawseti(L, -2, ++n);
+            }
+            break;
+        case mp_start_clip_code:
+            mplib_pdf_string(&b, "q\n");
+            mplib_pdf_path(&b, ((mp_clip_object *) p)->path_p, NULL);
+            mplib_pdf_string(&b, "W n\n");
+            break;
+        case mp_stop_clip_code:
+            mplib_pdf_string(&b, "Q\n");
+            break;
+        default:
+            break;
+        }
+    }
+    mplib_pdf_flush(L, &b, &n);
+    free(b.data);
+    return 1;
+}
 
 static int mplib_gr_fields(lua_State * L)
 {
@@ -1762,6 +2857,7 @@ static const struct luaL_reg mplib_fig_meta[] = {
     {"postscript",   mplib_fig_postscript},
     {"png",          mplib_fig_png},
     {"svg",          mplib_fig_svg},
+    {"pdfcontent",   mplib_fig_pdfcontent},
     {"boundingbox",  mplib_fig_bb},
     {"width",        mplib_fig_width},
     {"height",       mplib_fig_height},
@@ -290,6 +290,7 @@ static void mp_free (MP mp) {
   }
   xfree (mp->jump_buf);
   @<Free table entries@>;
+  @<Release the node slabs@>;
   free_math();
   xfree (mp);
 }
@@ -2744,13 +2745,16 @@ extern void *mp_xmalloc (MP mp, size_t nmem, size_t size);
 extern void mp_do_snprintf (char *str, int size, const char *fmt, ...);
 extern void *do_alloc_node(MP mp, size_t size);
 
-@ This is an attempt to spend less time in |malloc()|:
+@ This is an attempt to spend less time in |malloc()|. Token, symbolic,
+value and pair nodes and knots are needed by the million in path-heavy
+figures, so they are carved out of slabs of |node_slab_size| bytes. A node
+that is no longer needed goes to the free list of its kind, and is never
+returned to |malloc()| by itself: the slabs are released as a whole when the
+instance is freed.
 
-@d max_num_token_nodes 1000
-@d max_num_pair_nodes 1000
-@d max_num_knot_nodes 1000
-@d max_num_value_nodes 1000
-@d max_num_symbolic_nodes 1000
+@d node_slab_size 65536
+@d node_slab_align 16
+@d slab_rounded(A) (((A)+node_slab_align-1) & ~((size_t)node_slab_align-1))
 
 @<Global ...@>=
 mp_node token_nodes;
@@ -2763,6 +2767,11 @@ mp_node value_nodes;
 int num_value_nodes;
 mp_node symbolic_nodes;
 int num_symbolic_nodes;
+void *node_slabs; /* the slabs, linked through their first word */
+char *slab_ptr; /* the unused part of the current slab */
+size_t slab_left; /* and its size */
+int slab_count; /* the number of slabs */
+size_t slab_used; /* the number of bytes given out from slabs */
 
 @ @<Allocate or initialize ...@>=
 mp->token_nodes = NULL;
@@ -2775,37 +2784,67 @@ mp->value_nodes = NULL;
 mp->num_value_nodes = 0;
 mp->symbolic_nodes = NULL;
 mp->num_symbolic_nodes = 0;
+mp->node_slabs = NULL;
+mp->slab_ptr = NULL;
+mp->slab_left = 0;
+mp->slab_count = 0;
+mp->slab_used = 0;
 
-@ @<Dealloc ...@>=
-while (mp->value_nodes) {
-      mp_node p = mp->value_nodes;
-      mp->value_nodes = p->link;
-      mp_free_node(mp,p,value_node_size);
-}
-while (mp->symbolic_nodes) {
-      mp_node p = mp->symbolic_nodes;
-      mp->symbolic_nodes = p->link;
-      mp_free_node(mp,p,symbolic_node_size);
+@ @c
+static void *mp_slab_alloc (MP mp, size_t size) {
+  void *p;
+  size = slab_rounded (size);
+  if (size > mp->slab_left) {
+    char *s = xmalloc (1, node_slab_size);
+    *(void **) s = mp->node_slabs;
+    mp->node_slabs = s;
+    mp->slab_ptr = s + slab_rounded (sizeof (void *));
+    mp->slab_left = node_slab_size - slab_rounded (sizeof (void *));
+    mp->slab_count++;
+  }
+  p = mp->slab_ptr;
+  mp->slab_ptr += size;
+  mp->slab_left -= size;
+  mp->slab_used += size;
+  return p;
 }
-while (mp->pair_nodes) {
-      mp_node p = mp->pair_nodes;
-      mp->pair_nodes = p->link;
-      mp_free_node(mp,p,pair_node_size);
+
+@ The nodes on the free lists still own their numbers, which have to be
+freed in the arbitrary-precision modes (knots give up theirs when they are
+tossed). This is done after the table entries have been freed, because that
+puts a few more nodes on the free lists.
+
+@<Declarations@>=
+static void mp_free_node_list_numbers (MP mp, mp_node p);
+
+@ @c
+static void mp_free_node_list_numbers (MP mp, mp_node p) {
+  for (; p != NULL; p = p->link) {
+    if (p->has_number >= 1 && is_number(((mp_symbolic_node)p)->data.n)) {
+      free_number(((mp_symbolic_node)p)->data.n);
+    }
+    if (p->has_number == 2 && is_number(((mp_value_node)p)->subscript_)) {
+      free_number(((mp_value_node)p)->subscript_);
+    }
+  }
 }
-while (mp->token_nodes) {
-      mp_node p = mp->token_nodes;
-      mp->token_nodes = p->link;
-      mp_free_node(mp,p,token_node_size);
+
+@ @<Release the node slabs@>=
+if (mp->math_mode > mp_math_double_mode) {
+  mp_free_node_list_numbers (mp, mp->value_nodes);
+  mp_free_node_list_numbers (mp, mp->symbolic_nodes);
+  mp_free_node_list_numbers (mp, mp->token_nodes);
 }
-while (mp->knot_nodes) {
-      mp_knot p = mp->knot_nodes;
-      mp->knot_nodes = p->next;
-      mp_free_knot(mp,p);
+while (mp->node_slabs != NULL) {
+  void *s = mp->node_slabs;
+  mp->node_slabs = *(void **) s;
+  xfree (s);
 }
 
 @ This is a nicer way of allocating nodes.
 
 @d malloc_node(A) do_alloc_node(mp,(A))
+@d slab_node(A) do_alloc_slab_node(mp,(A))
 
 @
 @c
@@ -2817,6 +2856,14 @@ void *do_alloc_node (MP mp, size_t size) {
     ((mp_node)p)->has_number = 0;
     return p;
 }
+static void *do_alloc_slab_node (MP mp, size_t size) {
+    void *p;
+    p = mp_slab_alloc(mp,size);
+    add_var_used (size);
+    ((mp_node)p)->link = NULL;
+    ((mp_node)p)->has_number = 0;
+    return p;
+}
 
 
 @ The |max_size_test| guards against overflow, on the assumption that
@@ -2967,7 +3014,7 @@ static mp_node mp_get_symbolic_node (MP mp) {
     mp->num_symbolic_nodes--;
     p->link = NULL;
   } else {
-    p = malloc_node (symbolic_node_size);
+    p = slab_node (symbolic_node_size);
     new_number(p->data.n);
     p->has_number = 1;
   }
@@ -3009,31 +3056,16 @@ void mp_free_node (MP mp, mp_node p, size_t siz) {  /* node liberation */
 void mp_free_symbolic_node (MP mp, mp_node p) {  /* node liberation */
   FUNCTION_TRACE2 ("mp_free_symbolic_node(%p)\n", p);
   if (!p) return;
-  if (mp->num_symbolic_nodes < max_num_symbolic_nodes) {
-    p->link = mp->symbolic_nodes;
-    mp->symbolic_nodes = p;
-    mp->num_symbolic_nodes++;
-    return;
-  }
-  mp->var_used -= symbolic_node_size;
-  xfree (p);
+  p->link = mp->symbolic_nodes;
+  mp->symbolic_nodes = p;
+  mp->num_symbolic_nodes++;
 }
 void mp_free_value_node (MP mp, mp_node p) {  /* node liberation */
   FUNCTION_TRACE2 ("mp_free_value_node(%p)\n", p);
   if (!p) return;
-  if (mp->num_value_nodes < max_num_value_nodes) {
-    p->link = mp->value_nodes;
-    mp->value_nodes = p;
-    mp->num_value_nodes++;
-    return;
-  }
-  mp->var_used -= value_node_size;
-  assert(p->has_number == 2);
-  if (mp->math_mode > mp_math_double_mode) {
-    free_number(((mp_value_node)p)->data.n);
-    free_number(((mp_value_node)p)->subscript_);
-  }
-  xfree (p);
+  p->link = mp->value_nodes;
+  mp->value_nodes = p;
+  mp->num_value_nodes++;
 }
 
 
@@ -5220,7 +5252,7 @@ static mp_node mp_get_token_node (MP mp) {
     mp->num_token_nodes--;
     p->link = NULL;
   } else {
-    p = malloc_node (token_node_size);
+    p = slab_node (token_node_size);
     new_number(p->data.n);
     p->has_number = 1;
   }
@@ -5233,17 +5265,9 @@ static mp_node mp_get_token_node (MP mp) {
 static void mp_free_token_node (MP mp, mp_node p) {
   FUNCTION_TRACE2 ("mp_free_token_node(%p)\n", p);
   if (!p) return;
-  if (mp->num_token_nodes < max_num_token_nodes) {
-    p->link = mp->token_nodes;
-    mp->token_nodes = p;
-    mp->num_token_nodes++;
-    return;
-  }
-  mp->var_used -= token_node_size;
-  if (mp->math_mode > mp_math_double_mode) {
-    free_number(((mp_value_node)p)->data.n);
-  }
-  xfree (p);
+  p->link = mp->token_nodes;
+  mp->token_nodes = p;
+  mp->num_token_nodes++;
 }
 
 @ @<Declarations@>=
@@ -5659,7 +5683,7 @@ static mp_node mp_get_value_node (MP mp) {
     mp->num_value_nodes--;
     p->link = NULL;
   } else {
-    p = malloc_node (value_node_size);
+    p = slab_node (value_node_size);
     new_number(p->data.n);
     new_number(p->subscript_);
     p->has_number = 2;
@@ -5908,7 +5932,7 @@ static mp_node mp_get_pair_node (MP mp) {
     mp->num_pair_nodes--;
     p->link = NULL;
   } else {
-    p = malloc_node (pair_node_size);
+    p = slab_node (pair_node_size);
   }
   mp_type (p) = mp_pair_node_type;
   FUNCTION_TRACE2("get_pair_node(): %p\n", p);
@@ -5922,14 +5946,9 @@ void mp_free_pair_node (MP mp, mp_node p);
 void mp_free_pair_node (MP mp, mp_node p) {
   FUNCTION_TRACE2 ("mp_free_pair_node(%p)\n", p);
   if (!p) return;
-  if (mp->num_pair_nodes < max_num_pair_nodes) {
-    p->link = mp->pair_nodes;
-    mp->pair_nodes = p;
-    mp->num_pair_nodes++;
-    return;
-  }
-  mp->var_used -= pair_node_size;
-  xfree (p);
+  p->link = mp->pair_nodes;
+  mp->pair_nodes = p;
+  mp->num_pair_nodes++;
 }
 
 
@@ -7270,7 +7289,7 @@ static mp_knot mp_new_knot (MP mp) {
     mp->knot_nodes = q->next;
     mp->num_knot_nodes--;
   } else {
-    q = mp_xmalloc (mp, 1, sizeof (struct mp_knot_data));
+    q = mp_slab_alloc (mp, sizeof (struct mp_knot_data));
   }
   memset(q,0,sizeof (struct mp_knot_data));
   new_number(q->x_coord);
@@ -7303,7 +7322,7 @@ static mp_knot mp_copy_knot (MP mp, mp_knot p) {
     mp->knot_nodes = q->next;
     mp->num_knot_nodes--;
   } else {
-    q = mp_xmalloc (mp, 1, sizeof (struct mp_knot_data));
+    q = mp_slab_alloc (mp, sizeof (struct mp_knot_data));
   }
   memcpy (q, p, sizeof (struct mp_knot_data));
   if (mp->math_mode > mp_math_double_mode) {
@@ -7493,30 +7512,23 @@ calling the following subroutine.
 @<Declarations@>=
 static void mp_toss_knot_list (MP mp, mp_knot p);
 static void mp_toss_knot (MP mp, mp_knot p);
-static void mp_free_knot (MP mp, mp_knot p);
 
-@ @c
-void mp_free_knot  (MP mp, mp_knot q) {
-  free_number (q->x_coord);
-  free_number (q->y_coord);
-  free_number (q->left_x);
-  free_number (q->left_y);
-  free_number (q->right_x);
-  free_number (q->right_y);
-  mp_xfree (q);
-}
+@ Knots go back to the free list. Since |mp_new_knot| and |mp_copy_knot|
+make new numbers, the old ones are freed here.
+
+@c
 void mp_toss_knot (MP mp, mp_knot q) {
-  if (mp->num_knot_nodes < max_num_knot_nodes) {
-    q->next = mp->knot_nodes;
-    mp->knot_nodes = q;
-    mp->num_knot_nodes++;
-    return;
-  }
   if (mp->math_mode > mp_math_double_mode) {
-    mp_free_knot(mp,q);
-  } else {
-    mp_xfree (q);
+    free_number (q->x_coord);
+    free_number (q->y_coord);
+    free_number (q->left_x);
+    free_number (q->left_y);
+    free_number (q->right_x);
+    free_number (q->right_y);
   }
+  q->next = mp->knot_nodes;
+  mp->knot_nodes = q;
+  mp->num_knot_nodes++;
 }
 void mp_toss_knot_list (MP mp, mp_knot p) {
   mp_knot q;    /* the node being freed */
@@ -7533,13 +7545,9 @@ void mp_toss_knot_list (MP mp, mp_knot p) {
   } else {
     do {
       r = mp_next_knot (q);
-      if (mp->num_knot_nodes < max_num_knot_nodes) {
-        q->next = mp->knot_nodes;
-	mp->knot_nodes = q;
-	mp->num_knot_nodes++;
-      } else {
-        mp_xfree (q);
-      }
+      q->next = mp->knot_nodes;
+      mp->knot_nodes = q;
+      mp->num_knot_nodes++;
       q = r;
     } while (q != p);
   }
@@ -10693,7 +10701,7 @@ where the |then| clause is not executed.
 @ @<Remove knot |p| and back up |p| and |q| but don't go past |l|@>=
 {
   s = mp_prev_knot (p);
-  mp_xfree (p);
+  mp_toss_knot (mp, p);
   mp_next_knot (s) = q;
   mp_prev_knot (q) = s;
   if (s == l) {
@@ -10931,22 +10939,31 @@ This first set goes into the header
 #define new_angle(A) (((math_data *)(mp->math))->allocate)(mp, &(A), mp_angle_type)
 #define free_number(A) (((math_data *)(mp->math))->free)(mp, &(A))
 
-@
+@ In double mode most of the operations below are a single floating point
+operation, and the indirect call through |mp->math| costs more than the
+arithmetic itself. Those operations are therefore expanded inline when the
+instance runs in |mp_math_double_mode|; the expansions must compute exactly
+what the corresponding functions in \.{mpmathdouble.w} do. The other number
+systems, and the remaining operations, still go through the function table.
+
+@d is_double_math() (mp->math_mode == mp_math_double_mode)
+@d double_fraction_multiplier 4096.0 /* |fraction_multiplier| of \.{mpmathdouble.w} */
+@#
 @d set_precision()                     (((math_data *)(mp->math))->set_precision)(mp)
 @d free_math()                         (((math_data *)(mp->math))->free_math)(mp)
 @d scan_numeric_token(A)               (((math_data *)(mp->math))->scan_numeric)(mp, A)
 @d scan_fractional_token(A)            (((math_data *)(mp->math))->scan_fractional)(mp, A)
 @d set_number_from_of_the_way(A,t,B,C) (((math_data *)(mp->math))->from_oftheway)(mp, &(A),t,B,C)
-@d set_number_from_int(A,B)	       (((math_data *)(mp->math))->from_int)(&(A),B)
+@d set_number_from_int(A,B)	       (is_double_math() ? (void) ((A).data.dval = (B)) : (void) (((math_data *)(mp->math))->from_int)(&(A),B))
 @d set_number_from_scaled(A,B)	       (((math_data *)(mp->math))->from_scaled)(&(A),B)
 @d set_number_from_boolean(A,B)	       (((math_data *)(mp->math))->from_boolean)(&(A),B)
-@d set_number_from_double(A,B)	       (((math_data *)(mp->math))->from_double)(&(A),B)
-@d set_number_from_addition(A,B,C)     (((math_data *)(mp->math))->from_addition)(&(A),B,C)
-@d set_number_from_substraction(A,B,C) (((math_data *)(mp->math))->from_substraction)(&(A),B,C)
-@d set_number_from_div(A,B,C)          (((math_data *)(mp->math))->from_div)(&(A),B,C)
-@d set_number_from_mul(A,B,C)          (((math_data *)(mp->math))->from_mul)(&(A),B,C)
-@d number_int_div(A,C)                 (((math_data *)(mp->math))->from_int_div)(&(A),A,C)
-@d set_number_from_int_mul(A,B,C)      (((math_data *)(mp->math))->from_int_mul)(&(A),B,C)
+@d set_number_from_double(A,B)	       (is_double_math() ? (void) ((A).data.dval = (B)) : (void) (((math_data *)(mp->math))->from_double)(&(A),B))
+@d set_number_from_addition(A,B,C)     (is_double_math() ? (void) ((A).data.dval = (B).data.dval + (C).data.dval) : (void) (((math_data *)(mp->math))->from_addition)(&(A),B,C))
+@d set_number_from_substraction(A,B,C) (is_double_math() ? (void) ((A).data.dval = (B).data.dval - (C).data.dval) : (void) (((math_data *)(mp->math))->from_substraction)(&(A),B,C))
+@d set_number_from_div(A,B,C)          (is_double_math() ? (void) ((A).data.dval = (B).data.dval / (C).data.dval) : (void) (((math_data *)(mp->math))->from_div)(&(A),B,C))
+@d set_number_from_mul(A,B,C)          (is_double_math() ? (void) ((A).data.dval = (B).data.dval * (C).data.dval) : (void) (((math_data *)(mp->math))->from_mul)(&(A),B,C))
+@d number_int_div(A,C)                 (is_double_math() ? (void) ((A).data.dval = (A).data.dval / (C)) : (void) (((math_data *)(mp->math))->from_int_div)(&(A),A,C))
+@d set_number_from_int_mul(A,B,C)      (is_double_math() ? (void) ((A).data.dval = (B).data.dval * (C)) : (void) (((math_data *)(mp->math))->from_int_mul)(&(A),B,C))
 @#
 @d set_number_to_unity(A)	       (((math_data *)(mp->math))->clone)(&(A), unity_t)
 @d set_number_to_zero(A)	       (((math_data *)(mp->math))->clone)(&(A), zero_t)
@@ -10956,10 +10973,10 @@ This first set goes into the header
 @d init_randoms(A)                     (((math_data *)(mp->math))->init_randoms)(mp,A)
 @d print_number(A)                     (((math_data *)(mp->math))->print)(mp,A)
 @d number_tostring(A)                  (((math_data *)(mp->math))->tostring)(mp,A)
-@d make_scaled(R,A,B)                  (((math_data *)(mp->math))->make_scaled)(mp,&(R),A,B)
-@d take_scaled(R,A,B)                  (((math_data *)(mp->math))->take_scaled)(mp,&(R),A,B)
-@d make_fraction(R,A,B)                (((math_data *)(mp->math))->make_fraction)(mp,&(R),A,B)
-@d take_fraction(R,A,B)                (((math_data *)(mp->math))->take_fraction)(mp,&(R),A,B)
+@d make_scaled(R,A,B)                  (is_double_math() ? (void) ((R).data.dval = (A).data.dval / (B).data.dval) : (void) (((math_data *)(mp->math))->make_scaled)(mp,&(R),A,B))
+@d take_scaled(R,A,B)                  (is_double_math() ? (void) ((R).data.dval = (A).data.dval * (B).data.dval) : (void) (((math_data *)(mp->math))->take_scaled)(mp,&(R),A,B))
+@d make_fraction(R,A,B)                (is_double_math() ? (void) ((R).data.dval = ((A).data.dval / (B).data.dval) * double_fraction_multiplier) : (void) (((math_data *)(mp->math))->make_fraction)(mp,&(R),A,B))
+@d take_fraction(R,A,B)                (is_double_math() ? (void) ((R).data.dval = ((A).data.dval * (B).data.dval) / double_fraction_multiplier) : (void) (((math_data *)(mp->math))->take_fraction)(mp,&(R),A,B))
 @d pyth_add(R,A,B)                     (((math_data *)(mp->math))->pyth_add)(mp,&(R),A,B)
 @d pyth_sub(R,A,B)                     (((math_data *)(mp->math))->pyth_sub)(mp,&(R),A,B)
 @d n_arg(R,A,B)                        (((math_data *)(mp->math))->n_arg)(mp,&(R),A,B)
@@ -10978,24 +10995,24 @@ This first set goes into the header
 @d number_to_int(A)		       (((math_data *)(mp->math))->to_int)(A)
 @d number_to_boolean(A)		       (((math_data *)(mp->math))->to_boolean)(A)
 @d number_to_scaled(A)		       (((math_data *)(mp->math))->to_scaled)(A)
-@d number_to_double(A)		       (((math_data *)(mp->math))->to_double)(A)
-@d number_negate(A)		       (((math_data *)(mp->math))->negate)(&(A))
-@d number_add(A,B)		       (((math_data *)(mp->math))->add)(&(A),B)
-@d number_substract(A,B)	       (((math_data *)(mp->math))->substract)(&(A),B)
-@d number_half(A)		       (((math_data *)(mp->math))->half)(&(A))
-@d number_halfp(A)		       (((math_data *)(mp->math))->halfp)(&(A))
-@d number_double(A)		       (((math_data *)(mp->math))->do_double)(&(A))
-@d number_add_scaled(A,B)	       (((math_data *)(mp->math))->add_scaled)(&(A),B)
-@d number_multiply_int(A,B)	       (((math_data *)(mp->math))->multiply_int)(&(A),B)
-@d number_divide_int(A,B)	       (((math_data *)(mp->math))->divide_int)(&(A),B)
-@d number_abs(A)		       (((math_data *)(mp->math))->abs)(&(A))
+@d number_to_double(A)		       (is_double_math() ? (A).data.dval : (((math_data *)(mp->math))->to_double)(A))
+@d number_negate(A)		       (is_double_math() ? (void) ((A).data.dval = ((A).data.dval == 0.0 ? 0.0 : -(A).data.dval)) : (void) (((math_data *)(mp->math))->negate)(&(A)))
+@d number_add(A,B)		       (is_double_math() ? (void) ((A).data.dval = (A).data.dval + (B).data.dval) : (void) (((math_data *)(mp->math))->add)(&(A),B))
+@d number_substract(A,B)	       (is_double_math() ? (void) ((A).data.dval = (A).data.dval - (B).data.dval) : (void) (((math_data *)(mp->math))->substract)(&(A),B))
+@d number_half(A)		       (is_double_math() ? (void) ((A).data.dval = (A).data.dval / 2.0) : (void) (((math_data *)(mp->math))->half)(&(A)))
+@d number_halfp(A)		       (is_double_math() ? (void) ((A).data.dval = (A).data.dval / 2.0) : (void) (((math_data *)(mp->math))->halfp)(&(A)))
+@d number_double(A)		       (is_double_math() ? (void) ((A).data.dval = (A).data.dval * 2.0) : (void) (((math_data *)(mp->math))->do_double)(&(A)))
+@d number_add_scaled(A,B)	       (is_double_math() ? (void) ((A).data.dval = (A).data.dval + ((B) / 65536.0)) : (void) (((math_data *)(mp->math))->add_scaled)(&(A),B))
+@d number_multiply_int(A,B)	       (is_double_math() ? (void) ((A).data.dval = (double) ((A).data.dval * (B))) : (void) (((math_data *)(mp->math))->multiply_int)(&(A),B))
+@d number_divide_int(A,B)	       (is_double_math() ? (void) ((A).data.dval = (A).data.dval / (double) (B)) : (void) (((math_data *)(mp->math))->divide_int)(&(A),B))
+@d number_abs(A)		       (is_double_math() ? (void) ((A).data.dval = fabs((A).data.dval)) : (void) (((math_data *)(mp->math))->abs)(&(A)))
 @d number_modulo(A,B)		       (((math_data *)(mp->math))->modulo)(&(A), B)
 @d number_nonequalabs(A,B)	       (((math_data *)(mp->math))->nonequalabs)(A,B)
 @d number_odd(A)		       (((math_data *)(mp->math))->odd)(A)
-@d number_equal(A,B)		       (((math_data *)(mp->math))->equal)(A,B)
-@d number_greater(A,B)		       (((math_data *)(mp->math))->greater)(A,B)
-@d number_less(A,B)		       (((math_data *)(mp->math))->less)(A,B)
-@d number_clone(A,B)		       (((math_data *)(mp->math))->clone)(&(A),B)
+@d number_equal(A,B)		       (is_double_math() ? ((A).data.dval == (B).data.dval) : (((math_data *)(mp->math))->equal)(A,B))
+@d number_greater(A,B)		       (is_double_math() ? ((A).data.dval > (B).data.dval) : (((math_data *)(mp->math))->greater)(A,B))
+@d number_less(A,B)		       (is_double_math() ? ((A).data.dval < (B).data.dval) : (((math_data *)(mp->math))->less)(A,B))
+@d number_clone(A,B)		       (is_double_math() ? (void) ((A).data.dval = (B).data.dval) : (void) (((math_data *)(mp->math))->clone)(&(A),B))
 @d number_swap(A,B)		       (((math_data *)(mp->math))->swap)(&(A),&(B));
 @d convert_scaled_to_angle(A)          (((math_data *)(mp->math))->scaled_to_angle)(&(A));
 @d convert_angle_to_scaled(A)          (((math_data *)(mp->math))->angle_to_scaled)(&(A));
@@ -13364,7 +13381,7 @@ void mp_remove_cubic (MP mp, mp_knot p) {                               /* remov
   mp_next_knot (p) = mp_next_knot (q);
   number_clone (p->right_x, q->right_x);
   number_clone (p->right_y, q->right_y);
-  mp_xfree (q);
+  mp_toss_knot (mp, q);
 }
 
 
@@ -24111,7 +24128,7 @@ CONTINUE_PATH:
     mp_next_knot (path_q) = mp_next_knot (pp);
     number_clone (path_q->right_x, pp->right_x);
     number_clone (path_q->right_y, pp->right_y);
-    mp_xfree (pp);
+    mp_toss_knot (mp, pp);
     if (qq == pp)
       qq = path_q;
 
@@ -34679,6 +34696,9 @@ int mp_memory_usage (MP mp);
 int mp_hash_usage (MP mp);
 int mp_param_usage (MP mp);
 int mp_open_usage (MP mp);
+int mp_slab_usage (MP mp);
+int mp_slab_count (MP mp);
+int mp_free_node_count (MP mp);
 
 @ @c
 int mp_memory_usage (MP mp) {
@@ -34693,6 +34713,16 @@ int mp_param_usage (MP mp) {
 int mp_open_usage (MP mp) {
   return (int) mp->max_in_stack;
 }
+int mp_slab_usage (MP mp) {
+  return (int) mp->slab_used;
+}
+int mp_slab_count (MP mp) {
+  return mp->slab_count;
+}
+int mp_free_node_count (MP mp) {
+  return mp->num_token_nodes + mp->num_pair_nodes + mp->num_knot_nodes
+    + mp->num_value_nodes + mp->num_symbolic_nodes;
+}
 
 
 @ We get to the |final_cleanup| routine when \&{end} or \&{dump} has